@@ -5,4 +5,5 @@
 // * Functions
 
 void interrupts_setGate(int num, size_t handler);   // Set a gate in the IDT for a specific interrupt
+void interrupts_setTaskGate(int num, uint16_t selector);    // Set a task gate in the IDT for a specific interrupt
 void interrupts_init(void);                         // Initialize interrupt system
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "types.h"
+
+// * Constants
+
+#define PAGING_PAGESIZE         0x1000          // Size of a small page
+
+// Paging structure geometry (PAE build uses 64-bit entries, make PAE=1)
+
+#ifdef PAGING_PAE
+#define PAGING_LARGESIZE        0x200000        // Size of a large page and of the area covered by a page table
+#define PAGING_ENTRIES          512             // Entry count of a page directory or page table
+#define PAGING_DIRSHIFT         21              // Shift of page directory index in a virtual address
+#define PAGING_DIRENTRIES       2048            // Entry count of page directories of an address space (4 joined directories)
+#define PAGING_SPACEFRAMES      5               // Frame count of an address space (pointer table and 4 page directories)
+#define PAGING_PHYSLIMIT        0x1000000000ULL // Limit of usable physical memory (36-bit)
+#else
+#define PAGING_LARGESIZE        0x400000        // Size of a large (PSE) page and of the area covered by a page table
+#define PAGING_ENTRIES          1024            // Entry count of a page directory or page table
+#define PAGING_DIRSHIFT         22              // Shift of page directory index in a virtual address
+#define PAGING_DIRENTRIES       1024            // Entry count of page directory of an address space
+#define PAGING_SPACEFRAMES      1               // Frame count of an address space (page directory)
+#define PAGING_PHYSLIMIT        0x100000000ULL  // Limit of usable physical memory (32-bit)
+#endif
+
+// Virtual address space layout
+
+#define PAGING_IDENTLIMIT       0x40000000      // Limit of identity mapped kernel space (physical memory used by kernel)
+#define PAGING_USERBASE         0x40000000      // Base of process address space (programs are linked here)
+#define PAGING_USERLIMIT        0x80000000      // Limit of process address space
+#define PAGING_MMAPBASE         0x60000000      // Base of file mapping window (program images stay below)
+#define PAGING_USERSTACK        0x7FF00000      // Base of process stack (top of process address space, guard page below)
+#define PAGING_VMBASE           0x80000000      // Base of virtually contiguous allocation area (vmalloc)
+#define PAGING_VMLIMIT          0xC0000000      // Limit of virtually contiguous allocation area
+#define PAGING_VMPAGES          ((PAGING_VMLIMIT - PAGING_VMBASE) / PAGING_PAGESIZE)    // Page count of vmalloc area
+#define PAGING_IOBASE           0xE0000000      // Base of memory-mapped I/O window
+#define PAGING_IOLIMIT          0xFFC00000      // Limit of memory-mapped I/O window
+#define PAGING_KMAPBASE         0xFFC00000      // Base of temporary mapping window (reaches frames above identity map)
+#define PAGING_KMAPSLOTS        4               // Temporary mapping slot count (first half for kernel, second for page faults)
+#define PAGING_IOSLOTS          32              // Memory-mapped I/O mapping slot count
+#define PAGING_AREASLOTS        256             // Demand-paged area slot count
+#define PAGING_SPACESLOTS       32              // Process address space slot count
+
+// Page directory and page table entry flags
+
+#define PAGING_FLAG_PRESENT     (1 << 0)        // Page present
+#define PAGING_FLAG_WRITE       (1 << 1)        // Page writable
+#define PAGING_FLAG_USER        (1 << 2)        // Page accessible from user mode
+#define PAGING_FLAG_PWT         (1 << 3)        // Page write-through (PAT index bit 0)
+#define PAGING_FLAG_PCD         (1 << 4)        // Page cache disabled (PAT index bit 1)
+#define PAGING_FLAG_ACCESSED    (1 << 5)        // Page accessed
+#define PAGING_FLAG_DIRTY       (1 << 6)        // Page written
+#define PAGING_FLAG_LARGE       (1 << 7)        // Large page (only page directory entries)
+#define PAGING_FLAG_PTEPAT      (1 << 7)        // PAT index bit 2 (only page table entries)
+#define PAGING_FLAG_GLOBAL      (1 << 8)        // Global page (kept in TLB on CR3 reload)
+#define PAGING_FLAG_COW         (1 << 9)        // Copy-on-write page (available bit, write access cleared)
+#define PAGING_FLAG_SHARED      (1 << 10)       // Page frame not owned by address space (available bit, never freed)
+#define PAGING_FLAG_PDEPAT      (1 << 12)       // PAT index bit 2 (only large page directory entries)
+
+#ifdef PAGING_PAE
+#define PAGING_ADDRMASK         0x000FFFFFFFFFF000ULL   // Address mask of page table entries
+#define PAGING_LARGEMASK        0x000FFFFFFFE00000ULL   // Address mask of large page directory entries
+#else
+#define PAGING_ADDRMASK         0xFFFFF000      // Address mask of page table entries
+#define PAGING_LARGEMASK        0xFFC00000      // Address mask of large page directory entries
+#endif
+
+// Memory types (PAT entry indexes, falls back to PCD/PWT meaning without PAT)
+
+#define PAGING_CACHE_WB         0               // Write-back
+#define PAGING_CACHE_WT         1               // Write-through
+#define PAGING_CACHE_UC         3               // Uncached
+#define PAGING_CACHE_WC         7               // Write-combining (uncached without PAT)
+
+// Page fault error code bits
+
+#define PAGING_FAULT_PRESENT    (1 << 0)        // Fault on a present page (protection violation)
+#define PAGING_FAULT_WRITE      (1 << 1)        // Fault on write access
+#define PAGING_FAULT_USER       (1 << 2)        // Fault in user mode
+
+// Model specific registers
+
+#define PAGING_MSR_PAT          0x277           // Page attribute table MSR
+#define PAGING_PATVALUE         0x0107040600070406ULL   // WB, WT, UC-, UC, WB, WT, UC-, WC
+
+// * Types and structures
+
+#ifdef PAGING_PAE
+typedef uint64_t paging_Entry_t;        // Page directory or page table entry
+#else
+typedef uint32_t paging_Entry_t;        // Page directory or page table entry
+#endif
+
+// * Functions
+
+void    paging_init(void);                                  // Initialize paging
+bool    paging_map(size_t virt, uint64_t phys, uint32_t flags); // Map a small page
+uint64_t paging_unmap(size_t virt);                         // Unmap a small page
+uint64_t paging_phys(size_t virt);                          // Translate a virtual address
+void*   paging_mapIO(size_t phys, size_t size, uint8_t cache);  // Map a physical range with a memory type
+size_t  paging_createSpace(void);                           // Create a process address space
+size_t  paging_cloneSpace(size_t space);                    // Clone a process address space (copy-on-write)
+void    paging_destroySpace(size_t space);                  // Destroy a process address space with its pages
+void    paging_switch(size_t space);                        // Switch to an address space
+size_t  paging_current(void);                               // Get current address space
+size_t  paging_kernelSpace(void);                           // Get kernel address space
+bool    paging_mapRange(size_t space, size_t virt, size_t size, uint32_t flags);   // Map cleared pages to a range
+bool    paging_copyTo(size_t space, size_t virt, const void* src, size_t size);     // Copy data into an address space
+size_t  paging_usage(size_t space, size_t* peak);           // Get mapped page count of process address space (and its peak)
+bool    paging_mapPage(size_t space, size_t virt, uint64_t phys, uint32_t flags);   // Map a page into an address space
+void    paging_unmapRange(size_t space, size_t virt, size_t size);                 // Unmap a range and free its pages
+size_t  paging_findRange(size_t space, size_t size);        // Find a free range in file mapping window
+bool    paging_addArea(size_t space, size_t base, size_t size, uint32_t flags,    // Register a demand-paged area
+            const void* data, size_t datasize);
+void    paging_removeArea(size_t space, size_t base);       // Unregister a demand-paged area
+bool    paging_fault(size_t addr, uint32_t code);           // Try to resolve a page fault
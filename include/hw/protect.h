@@ -2,6 +2,18 @@
 
 #include "types.h"
 
+// * Constants
+
+#define PROTECT_SEL_CODE        0x08            // Kernel code segment selector
+#define PROTECT_SEL_DATA        0x10            // Kernel data segment selector
+#define PROTECT_SEL_TASK        0x18            // Kernel task state segment selector
+#define PROTECT_SEL_FAULTTASK   0x20            // Page fault task state segment selector
+#define PROTECT_SEL_DOUBLETASK  0x28            // Double fault task state segment selector
+
 // * Functions
 
-void protect_init(void);    // Function for initialize the GDT
\ No newline at end of file
+void protect_init(void);                                    // Function for initialize the GDT
+void protect_setFaultTask(size_t entry, size_t stack);      // Function for set up the page fault task
+void protect_setDoubleTask(size_t entry, size_t stack);     // Function for set up the double fault task
+bool protect_faultTaskBusy(void);                           // Function for check page fault task is running
+void protect_setTaskCR3(size_t cr3);                        // Function for set address space of kernel and page fault tasks
\ No newline at end of file
@@ -13,6 +13,31 @@ extern char kernel_Base, kernel_Limit;
 #define KERNEL_VERSION              "Deputy Kernel Build " NUMBER(KERNEL_BUILD) " (Jul 2025)"
 #define KERNEL_PLATFORM             "deputy/i386"
 
+#define KERNEL_FEAT_TSC             0x00000001  // CPU feature: time stamp counter
+#define KERNEL_FEAT_TSCINV          0x00000002  // CPU feature: invariant (stable) time stamp counter
+#define KERNEL_FEAT_PSE             0x00000004  // CPU feature: 4 MB pages
+#define KERNEL_FEAT_PAE             0x00000008  // CPU feature: physical address extension
+#define KERNEL_FEAT_PGE             0x00000010  // CPU feature: global pages
+#define KERNEL_FEAT_PAT             0x00000020  // CPU feature: page attribute table
+#define KERNEL_FEAT_FXSR            0x00000040  // CPU feature: FXSAVE/FXRSTOR
+#define KERNEL_FEAT_SSE             0x00000080  // CPU feature: SSE
+#define KERNEL_FEAT_SSE2            0x00000100  // CPU feature: SSE2 (non-temporal integer stores)
+#define KERNEL_FEAT_SSE42           0x00000200  // CPU feature: SSE4.2 (CRC32 instruction)
+#define KERNEL_FEAT_POPCNT          0x00000400  // CPU feature: POPCNT instruction
+#define KERNEL_FEAT_AES             0x00000800  // CPU feature: AES instructions
+#define KERNEL_FEAT_XSAVE           0x00001000  // CPU feature: XSAVE/XRSTOR
+#define KERNEL_FEAT_AVX             0x00002000  // CPU feature: AVX
+#define KERNEL_FEAT_AVX2            0x00004000  // CPU feature: AVX2
+#define KERNEL_FEAT_RDRAND          0x00008000  // CPU feature: RDRAND instruction
+#define KERNEL_FEAT_VTX             0x00010000  // CPU feature: VT-x
+#define KERNEL_FEAT_ERMS            0x00020000  // CPU feature: enhanced REP MOVSB/STOSB
+#define KERNEL_FEAT_FSRM            0x00040000  // CPU feature: fast short REP MOVSB
+#define KERNEL_FEAT_X64             0x00080000  // CPU feature: long mode
+#define KERNEL_FEAT_NTMEM           0x80000000  // Kernel option: non-temporal stores for large copy/fill (make NTMEM=1)
+
+// Macro function for check whether CPU has all given features (KERNEL_FEAT_*)
+#define KERNEL_HAS(mask)            ((kernel_CPUInfo.features & (mask)) == (mask))
+
 #define INFO(format, ...) \
     do { printf("%s: " format "\n", __func__, ##__VA_ARGS__); } while (0)
 
@@ -40,20 +65,26 @@ typedef struct {
     uint64_t frequency;     // Current frequency
     uint32_t cores;         // Core count
     uint32_t threads;       // Thread count
+    uint32_t features;      // Feature bitmap (KERNEL_FEAT_*)
     uint32_t has_tsc;       // TSC support (stable if bit 1 set)
     uint32_t has_sse;       // SSE support
     uint32_t has_avx;       // AVX support
     uint32_t has_vtx;       // VT-x support
     uint32_t has_aes;       // AES support
     uint32_t has_x64;       // x64 support
+    uint32_t has_pse;       // 4 MB page support
+    uint32_t has_pge;       // Global page support
+    uint32_t has_pat;       // Page attribute table support
+    uint32_t has_pae;       // Physical address extension support
 } kernel_CPUInfo_t;
 
 // Variables and tables
 
 extern size_t           kernel_PhysicalSize;    // Physical size of the kernel in memory
 extern size_t           kernel_OSModuleSize;    // Operating system module size in memory
-extern size_t           kernel_MemorySize;      // Memory size of the machine
+extern uint64_t         kernel_MemorySize;      // Memory size of the machine
 extern kernel_CPUInfo_t kernel_CPUInfo;         // CPU information table
+extern void*            kernel_Framebuffer;     // Linear framebuffer given by bootloader (null if text mode)
 
 // * Console
 
@@ -72,6 +103,8 @@ void console_print(const char* str, int len);
 
 #define UTILS_TABLENGTH             8       // Tabulation length
 
+#define UTILS_MEM_NTLIMIT           (4 * 1024 * 1024)   // Block size from which non-temporal stores are used (beyond cache)
+
 #define UTILS_DISKPARTBOOTSIGN      0x80    // Partition boot signature
 #define UTILS_DISKPARTTABLEOFF      0x01BE  // Partition table offset
 
@@ -107,6 +140,8 @@ typedef struct {
 // Subfunctions
 
 uint64_t    utils_rdtsc(void);                              // Read Time Stamp Counter
+uint64_t    utils_rdmsr(uint32_t msr);                      // Read Model Specific Register
+void        utils_wrmsr(uint32_t msr, uint64_t value);      // Write Model Specific Register
 uint8_t     utils_bcd2dec(uint8_t bcd);                     // Convert binary coded decimal to decimal
 int         utils_oct2bin(const char *str, int len);        // Convert ASCII octal number into binary
 char*       utils_itoa(int num);                            // Convert integer to ASCII string
@@ -118,6 +153,8 @@ void        utils_cpuid(                                    // Get CPU informati
                 uint32_t leaf, uint32_t subleaf,
                 uint32_t* eax, uint32_t* ebx,
                 uint32_t* ecx, uint32_t* edx);
+uint32_t    utils_cpuFeatures(void);                        // Decode CPU feature bitmap (KERNEL_FEAT_*) by CPUID
+void        utils_patch(uint32_t features);                 // Select best variants of primitives for given CPU features
 
 
 // Functions
@@ -127,6 +164,7 @@ void        utils_cpuid(                                    // Get CPU informati
 uint32_t    xorshift32(uint32_t state);                     // Convert a seed to a pseudo-random 32-bit integer
 void        xorcipher(char* input, const char* key);        // Encrypt or decrypt data with a key
 uint32_t    fnv1ahash(const uint8_t* data, size_t len);     // Hash the given data using FNV-1a hash algorithm
+uint32_t    crc32c(const uint8_t* data, size_t len, uint32_t crc);  // Calculate CRC32C checksum of the given data
 
 // Timing functions
 
@@ -139,6 +177,7 @@ void        sleep(uint32_t sec);        // Sleep the system for a certain amount
 void*       fill(void* ptr, char chr, size_t len);          // Fill a block of memory with specific value
 char*       copy(char* dest, const char* src);              // Copy a block of memory from source to destination
 void*       ncopy(void* dest, const void* src, size_t len); // Copy a block of memory from source to destination with limit
+uint32_t    ncopysum(void* dest, const void* src, size_t len);  // Copy a block of memory and calculate its CRC32C
 
 // Comparison functions
 
@@ -168,15 +207,72 @@ void        printf(const char* fmt, ...);               // Print formatted outpu
 // Constants
 
 #define MEMORY_BLKSIZE      (4 * 1024)          // Memory block size
+#define MEMORY_SLABMIN      16                  // Smallest size class of slab allocator
+#define MEMORY_SLABMAX      2048                // Largest size class of slab allocator
+#define MEMORY_CACHELIMIT   32                  // Limit of object caches (size classes included)
+#define MEMORY_ZONELIMIT    16                  // Limit of physical memory zones (kernel zone included)
+#define MEMORY_HIGHLIMIT    16                  // Limit of high memory regions (above identity mapped kernel space)
+#define MEMORY_DMASIZE      (2 * 1024 * 1024)   // Size of DMA pool reserved from kernel zone
+
+// Structures
+
+// Structure of memory allocator statistics
+typedef struct {
+    size_t total;           // Total block count
+    size_t free;            // Free block count
+    size_t used;            // Used block count
+    size_t peak;            // High-water mark of used blocks
+    size_t largestblock;    // Largest free buddy chunk of heap zones (in blocks, adjacent chunks not merged)
+    size_t slabs;           // Slab page count of object caches
+    size_t zones;           // Physical memory zone count
+    size_t dma;             // DMA pool block count
+    size_t dmafree;         // Free block count of DMA pool
+    size_t frames;          // Frame pool block count
+    size_t framefree;       // Free block count of frame pool
+    size_t framezero;       // Pre-zeroed block count of frame pool
+    size_t high;            // High memory frame count
+    size_t highfree;        // Free frame count of high memory
+    uint32_t allocs;        // Successful allocation count
+    uint32_t frees;         // Free count
+    uint32_t failures;      // Failed allocation count
+} memory_Stats_t;
 
 // Functions
 
 void*       malloc(size_t size);                // Allocates memory
-void*       calloc(size_t nmemb, size_t size);  // Allocates cleared memory
+void*       calloc(size_t nmemb, size_t size);  // Allocates cleared memory (physically contiguous, see vzalloc for demand-zero)
 void*       realloc(void* blk, size_t size);    // Reallocates memory
 void        free(void* blk);                    // Frees memory
-size_t      mavail(void);                       // Returns free space
+void*       vmalloc(size_t size);               // Allocates virtually contiguous memory
+void*       vzalloc(size_t size);               // Allocates virtually contiguous demand-zero memory
+void        vfree(void* addr);                  // Frees virtually contiguous memory
+size_t      vsize(void* addr);                  // Returns size of virtually contiguous memory
+size_t      mavail(void);                       // Returns free heap space (frame pool, DMA pool and high memory excluded)
 void        memory_init(size_t size);           // Initializes memory manager
+int         memory_addZone(size_t base, size_t size);       // Adds a physical memory zone
+int         memory_addHigh(uint64_t base, uint64_t size);   // Adds a high memory region
+void*       dma_alloc(size_t size, size_t align, size_t boundary, uint64_t* phys);  // Allocates a DMA buffer
+void        dma_free(void* buf);                                                    // Frees a DMA buffer
+void*       frame_alloc(void);                  // Allocates a physical page frame
+void        frame_free(void* frame);            // Frees a physical page frame
+void*       frame_allocRun(size_t count);               // Allocates a run of contiguous page frames
+void        frame_freeRun(void* frame, size_t count);   // Frees a run of contiguous page frames
+bool        frame_share(void* frame);                   // Adds a reference to a page frame
+size_t      frame_refs(void* frame);                    // Gets extra reference count of a page frame
+void*       frame_allocZero(void);                      // Allocates a cleared physical page frame
+size_t      frame_prezero(size_t count);                // Clears free page frames ahead of time
+uint64_t    frame_allocHigh(void);                      // Allocates a page frame from high memory
+void        frame_freeHigh(uint64_t phys);              // Frees a page frame of high memory
+void        memory_stats(memory_Stats_t* stats);            // Gets allocator statistics
+size_t      memory_info(char* buf, size_t len);             // Writes allocator statistics as text
+
+int         memory_cacheCreate(const char* name, size_t size);  // Creates an object cache
+int         memory_cacheDestroy(int cache);                     // Destroys an empty object cache
+void*       memory_cacheAlloc(int cache);                       // Allocates an object from cache
+void        memory_cacheFree(int cache, void* obj);             // Frees an object back to cache
+
+void        memory_profTag(const char* tag);    // Sets subsystem tag of following allocations (profiler builds)
+void        memory_report(void);                // Dumps allocation profile over serial (profiler builds)
 
 // * Core File System
 
@@ -194,6 +290,9 @@ void        memory_init(size_t size);           // Initializes memory manager
 #define FS_TYPE_DIR             5               // Directory type in file system
 #define FS_TYPE_FIFO            6               // Named pipe (FIFO) type in file system
 #define FS_TYPE_MOUNTED         7               // Mounted file
+#define FS_TYPE_PSEUDO          8               // Pseudo file (content generated on read)
+
+#define FS_PSEUDOSIZE           MEMORY_BLKSIZE  // Content capacity of pseudo files
 
 #define FS_ROOTDIR              0               // Index of root directory
 
@@ -233,6 +332,9 @@ typedef struct {
     uint8_t ftype;                      // File type
     uint8_t devperm;                    // Device permissions
     int mountslot;                      // Mounted slot number
+    size_t (*generator)(char* buf, size_t len); // Content generator (only pseudo files)
+    char* content;                      // Content (vmalloc, only regular and pseudo files)
+    size_t pages;                       // Page count of content
 } fs_Entry_t;
 
 // Functions
@@ -248,6 +350,8 @@ int             fs_createDir(const char* path);
 
 char*           fs_readFile(const char* path);                                  // Read specific file
 int             fs_writeFile(const char* path, size_t size, char* buf);         // Write a file
+int             fs_createPseudo(const char* path,                               // Create a pseudo file
+                    size_t (*generator)(char* buf, size_t len));
 
 int             fs_remove(const char* path);                                    // Remove a file/directory
 int             fs_bulkRemove(const char* path);                                // Remove bulk files and directories
@@ -264,10 +368,32 @@ extern bool multitask_InStream;         // Active if the process stream started
 
 int         spawn(const char* name, func_t prog);   // Spawns a process
 int         exec(const char* path);                 // Execute program from file system
+int         fork(void);                             // Clones current process (pages copied on write)
 int         kill(int pid);                          // Kills a process
 void        yield(void);                            // Switchs to next process
 void        exit(void);                             // Ends current process
 void        multitask_init(void);                   // Initializes multitasking system
+void        multitask_fpuTrap(void);                // Switches FPU/SSE state to current process (#NM handler)
+size_t      multitask_info(char* buf, size_t len);  // Writes process memory usage as text
+
+// * Shared Memory
+
+// Constants
+
+#define SHM_OBJECTLIMIT     32                  // Limit of shared memory objects
+#define SHM_MAPLIMIT        128                 // Limit of shared memory handles and mappings (all processes)
+#define SHM_NAMELIMIT       32                  // Name length limit of shared memory objects
+
+// Functions
+
+int         shm_create(const char* name, size_t size);      // Creates a named shared memory object
+int         shm_open(const char* name);                     // Opens a shared memory object by name
+void*       shm_map(int object, int prot);                  // Maps a shared memory object
+int         shm_unmap(void* addr);                          // Unmaps a shared memory object
+int         shm_close(int object);                          // Closes a handle of a shared memory object
+int         shm_release(void* addr, size_t len);            // Unmaps shared memory mappings of a range (for munmap)
+void        shm_detach(size_t space);                       // Drops shared memory handles and mappings of an address space
+bool        shm_clone(size_t space, size_t clone);          // Records shared memory handles and mappings of a cloned address space
 
 // * Driver manager
 
@@ -294,6 +420,14 @@ void mountmgr_init();
 #define SYS_WRITE       0x04                        // Write data to specific file descriptor
 #define SYS_OPEN        0x05                        // Open a file descriptor
 #define SYS_CLOSE       0x06                        // Close a file descriptor
+#define SYS_FORK        0x07                        // Clone current process
+#define SYS_MMAP        0x08                        // Map a file into memory
+#define SYS_MUNMAP      0x09                        // Unmap a file mapping
+#define SYS_SHMCREATE   0x0A                        // Create a shared memory object
+#define SYS_SHMOPEN     0x0B                        // Open a shared memory object
+#define SYS_SHMMAP      0x0C                        // Map a shared memory object
+#define SYS_SHMUNMAP    0x0D                        // Unmap a shared memory object
+#define SYS_SHMCLOSE    0x0E                        // Close a shared memory object handle
 #define SYS_YIELD       0x9E                        // Switch to next process
 
 // File descriptors
@@ -311,6 +445,10 @@ void mountmgr_init();
 #define O_TRUNC         (1 << 5)                    // Truncate file if exists
 #define O_APPEND        (1 << 6)                    // All writes to file will be appended to end
 
+// Mapping protection flags
+#define PROT_READ       (1 << 0)                    // Mapping can be read
+#define PROT_WRITE      (1 << 1)                    // Mapping can be written (private copy on write)
+
 // Variables
 
 // Access file forcefully if this flag set (only for kernel components)
@@ -322,4 +460,8 @@ void    syscall_init();                             // Initializes system call m
 size_t  read(int fd, void* buf, size_t count);      // Read data from a specific file descriptor
 size_t  write(int fd, void* buf, size_t count);     // Write data to specific file descriptor
 int     open(char* path, int flags);                // Open a file descriptor
-int     close(int fd);                              // Close a file descriptor
\ No newline at end of file
+int     close(int fd);                              // Close a file descriptor
+void*   mmap(void* addr, size_t length, int prot, int fd, size_t offset);  // Map a file into memory
+int     munmap(void* addr, size_t length);          // Unmap a file mapping
+void    iocall_detach(size_t space);                // Drops file mapping records of an address space
+bool    iocall_clone(size_t space, size_t clone);   // Records file mappings of a cloned address space
\ No newline at end of file
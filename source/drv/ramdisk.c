@@ -8,8 +8,10 @@ int ramdisk_create(ramdisk_t* disk, size_t blimit, size_t bsize) {
     if (!disk || blimit == 0 || bsize == 0) { return -1; }
     disk->bsize     = bsize;
     disk->blimit    = blimit;
-    disk->storage   = calloc(blimit, bsize);
-    if (!disk->storage) { return -1; } return 0;
+    if (blimit > (size_t)-1 / bsize) { return -1; }
+    disk->storage   = vzalloc(blimit * bsize);     // Blocks take memory on first write
+    if (!disk->storage) { return -1; }
+    return 0;
 }
 
 int ramdisk_read(ramdisk_t* disk, size_t lba, void* buf, size_t num) {
@@ -32,7 +34,7 @@ int ramdisk_write(ramdisk_t* disk, size_t lba, const void* buf, size_t num) {
 
 int ramdisk_remove(ramdisk_t* disk) {
     if (!disk || !disk->storage) { return -1; }
-    free(disk->storage);
+    vfree(disk->storage);
     disk->storage = NULL;
     disk->bsize = 0;
     disk->blimit = 0;
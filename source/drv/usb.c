@@ -2,6 +2,7 @@
 
 #include "kernel.h"
 #include "hw/devbus.h"
+#include "hw/paging.h"
 
 typedef struct {
     uint8_t CAPLENGTH;
@@ -598,6 +599,12 @@ usb_EventTRB_t* usb_EventRing;
 
 usb_Port_t* usb_PortV;
 
+// Function for free device contexts, their pointer array and port table taken by init
+static void usb_freeContexts(uint64_t* dcbaa, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) { dma_free(usb_PortV[i].devctx); }
+    dma_free(dcbaa); free(usb_PortV);
+}
+
 void usb_doorbell(uint8_t slot, uint8_t ring) {
     if (!usb_InitLock) { ERR("USB host controller not initialized"); return; }
     usb_DBregs[slot].Target = ring;
@@ -669,11 +676,20 @@ int usb_init(devbus_Device_t* dev) {
     INFO("xHCI release number: 0x%x", devbus_read(dev->bus, dev->slot, dev->func, 24) & 0xFF);
     devbus_BAR_t bar; devbus_getBAR(&bar, dev->bus, dev->slot, dev->func, 0);
     if (bar.type != DEVBUS_BARTYPE_MM) { ERR("Device BAR is not memory-mapped"); return -1; }
-    usb_Capregs = (usb_Capregs_t*)bar.addr;
+    // Map capability registers as uncached, then map whole register space they describe
+    usb_Capregs = (usb_Capregs_t*)paging_mapIO(bar.addr, sizeof(usb_Capregs_t), PAGING_CACHE_UC);
+    if (usb_Capregs == NULL) { ERR("Unable to map xHCI registers"); return -1; }
+    size_t rtsoff = usb_Capregs->RTSOFF & USB_CAPREG_RTSOFF, dboff = usb_Capregs->DBOFF & USB_CAPREG_DBOFF;
+    size_t regsize = usb_Capregs->CAPLENGTH + sizeof(usb_Opregs_t);
+    if (rtsoff + sizeof(usb_RTregs_t) > regsize) { regsize = rtsoff + sizeof(usb_RTregs_t); }
+    if (dboff + (256 * sizeof(usb_DBregs_t)) > regsize) { regsize = dboff + (256 * sizeof(usb_DBregs_t)); }
+    size_t regs = (size_t)paging_mapIO(bar.addr, regsize, PAGING_CACHE_UC);
+    if (regs == 0) { ERR("Unable to map xHCI registers"); return -1; }
+    usb_Capregs = (usb_Capregs_t*)regs;
     INFO("xHCI version: 0x%x", usb_Capregs->HCIVERSION);
-    usb_Opregs = (usb_Opregs_t*)(bar.addr + usb_Capregs->CAPLENGTH);
-    usb_RTregs = (usb_RTregs_t*)(bar.addr + (usb_Capregs->RTSOFF & USB_CAPREG_RTSOFF));
-    usb_DBregs = (usb_DBregs_t*)(bar.addr + (usb_Capregs->DBOFF & USB_CAPREG_DBOFF));
+    usb_Opregs = (usb_Opregs_t*)(regs + usb_Capregs->CAPLENGTH);
+    usb_RTregs = (usb_RTregs_t*)(regs + rtsoff);
+    usb_DBregs = (usb_DBregs_t*)(regs + dboff);
     // --------------------------------------------------------------------------------------
     while (usb_Opregs->USBSTS & USB_OPREG_STS_CNR);
     // --------------------------------------------------------------------------------------
@@ -682,56 +698,50 @@ int usb_init(devbus_Device_t* dev) {
     // --------------------------------------------------------------------------------------
     uint32_t pagesize = 0;
     for (int i = 0; i < 32; ++i) { if (usb_Opregs->PAGESIZE & (1 << i)) { pagesize = 1 << (12 + i); break; } }
-    uint64_t* dcbaa = (uint64_t*)calloc(usb_Opregs->CONFIG & USB_OPREG_CONFIG_MAXSLOTSEN, sizeof(uint64_t));
-    if (dcbaa == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST; return -1; }
-    if (((size_t)dcbaa & ~(MEMORY_BLKSIZE-1)) != (size_t)dcbaa)
-        { ERR("Memory block not aligned"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST; free(dcbaa); return -1; }
-    void* dcbase = calloc(usb_Opregs->CONFIG & USB_OPREG_CONFIG_MAXSLOTSEN, pagesize);
-    if (dcbase == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST; free(dcbaa); return -1; }
-    if (((size_t)dcbase & ~(MEMORY_BLKSIZE-1)) != (size_t)dcbase) {
-        ERR("Memory block not aligned"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST;
-        free(dcbaa); free(dcbase); return -1;
+    uint32_t maxslots = usb_Opregs->CONFIG & USB_OPREG_CONFIG_MAXSLOTSEN; uint64_t dcbaaphys;
+    usb_PortV = (usb_Port_t*)calloc(maxslots, sizeof(usb_Port_t));
+    if (usb_PortV == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST; return -1; }
+    uint64_t* dcbaa = (uint64_t*)dma_alloc(maxslots * sizeof(uint64_t), 64, pagesize, &dcbaaphys);
+    if (dcbaa == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST; free(usb_PortV); return -1; }
+    // Device contexts are taken a page each, DCBAA holds a pointer per slot (DMA pool can't give 255 pages in one piece)
+    for (uint32_t i = 0; i < maxslots; ++i) {
+        uint64_t dcphys; usb_PortV[i].devctx = dma_alloc(pagesize, pagesize, 0, &dcphys);
+        if (usb_PortV[i].devctx == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST;
+            usb_freeContexts(dcbaa, i); return -1; }
+        dcbaa[i] = dcphys;
     }
-    for (uint32_t i = 0; i < (usb_Opregs->CONFIG & USB_OPREG_CONFIG_MAXSLOTSEN); ++i)
-        { dcbaa[i] = (size_t)dcbase + (i * pagesize); }
-    usb_Opregs->DCBAAP = (uint64_t)(size_t)dcbaa & (uint64_t)~USB_OPREG_DCBAAP_RSVDZ;
+    usb_Opregs->DCBAAP = dcbaaphys & (uint64_t)~USB_OPREG_DCBAAP_RSVDZ;
     // --------------------------------------------------------------------------------------
     // ! Command ring not working, fix it
-    usb_CmdRing = (usb_TRB_t*)calloc(USB_TRBCOUNT, sizeof(usb_TRB_t));
+    uint64_t crphys; usb_CmdRing = (usb_TRB_t*)dma_alloc(USB_TRBCOUNT * sizeof(usb_TRB_t), 64, 0x10000, &crphys);
     if (usb_CmdRing == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST;
-        free(dcbaa); free(dcbase); return -1; }
-    if (((size_t)usb_CmdRing & ~(MEMORY_BLKSIZE-1)) != (size_t)usb_CmdRing) {
-        ERR("Memory block not aligned"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST;
-        free(dcbaa); free(dcbase); free(usb_CmdRing); return -1;
-    }
+        usb_freeContexts(dcbaa, maxslots); return -1; }
     // usb_Opregs->CRCR = (uint64_t)((size_t)usb_CmdRing & USB_OPREG_CRCR_RINGPTRLO);
-    uint64_t crptr = (uint64_t)(size_t)usb_CmdRing & ~0x3FULL; // [63:6] pointer
+    uint64_t crptr = crphys & ~0x3FULL;                         // [63:6] pointer
     usb_Opregs->CRCR = crptr | 1ULL;                           // bit0 = RCS=1
     // --------------------------------------------------------------------------------------
-    usb_PortV = (usb_Port_t*)calloc(usb_Opregs->CONFIG & USB_OPREG_CONFIG_MAXSLOTSEN, sizeof(usb_Port_t));
-    if (usb_PortV == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST;
-        free(dcbaa); free(dcbase); free(usb_CmdRing); return -1; }
-    // --------------------------------------------------------------------------------------
-    usb_ERSTent = (usb_evtring_seg_t*)calloc(1, sizeof(usb_evtring_seg_t));
+    uint64_t erstphys, erphys;
+    usb_ERSTent = (usb_evtring_seg_t*)dma_alloc(sizeof(usb_evtring_seg_t), 64, 0, &erstphys);
     if (usb_ERSTent == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST;
-        free(usb_ERSTent); free(dcbaa); free(dcbase); free(usb_CmdRing); return -1; }
-    usb_EventRing = (usb_EventTRB_t*)calloc(USB_EVENTRING_TRBCOUNT, sizeof(usb_EventTRB_t));
+        usb_freeContexts(dcbaa, maxslots); dma_free(usb_CmdRing); return -1; }
+    usb_EventRing = (usb_EventTRB_t*)dma_alloc(USB_EVENTRING_TRBCOUNT * sizeof(usb_EventTRB_t), 64, 0x10000, &erphys);
     if (usb_EventRing == NULL) { ERR("Out of memory"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST;
-        free(usb_EventRing); free(dcbaa); free(dcbase); free(usb_CmdRing); return -1; }
-    usb_ERSTent->base = (uint64_t)(size_t)usb_EventRing;
+        dma_free(usb_ERSTent); usb_freeContexts(dcbaa, maxslots); dma_free(usb_CmdRing); return -1; }
+    usb_ERSTent->base = erphys;
     usb_ERSTent->trb_count = USB_EVENTRING_TRBCOUNT;
     usb_RTregs->IR[0].IMAN = 0;
     usb_RTregs->IR[0].IMOD = 0;
     usb_RTregs->IR[0].ERSTSZ = 1;
-    usb_RTregs->IR[0].ERSTBA = (uint64_t)(size_t)usb_ERSTent;
-    usb_RTregs->IR[0].ERDP = (uint64_t)(size_t)usb_EventRing;
+    usb_RTregs->IR[0].ERSTBA = erstphys;
+    usb_RTregs->IR[0].ERDP = erphys;
     // --------------------------------------------------------------------------------------
     usb_Opregs->USBCMD |= USB_OPREG_CMD_RS;
     uint32_t timeout = 100000;
     while ((usb_Opregs->USBSTS & USB_OPREG_STS_HCH) && --timeout);
     if (usb_Opregs->USBSTS & USB_OPREG_STS_HCH) {
         ERR("Host controller activation timed out"); usb_Opregs->USBCMD |= USB_OPREG_CMD_HCRST;
-        free(dcbaa); free(dcbase); free(usb_CmdRing); return -1;
+        dma_free(usb_EventRing); dma_free(usb_ERSTent);
+        usb_freeContexts(dcbaa, maxslots); dma_free(usb_CmdRing); return -1;
     }
     // --------------------------------------------------------------------------------------
     INFO("xHCI driver initialized"); usb_InitLock = true;
@@ -2,6 +2,7 @@
 
 #include "kernel.h"
 #include "hw/port.h"
+#include "hw/paging.h"
 
 // * Types and structures
 
@@ -28,6 +29,15 @@ bool acpi_InitLock = false;     // Initialize lock for prevent re-initializing A
 
 acpiTable_t acpiTable;          // Public ACPI table for other kernel components
 
+// * Subfunctions
+
+// Function for map a system description table (tables can be above identity mapped kernel space)
+static acpi_SDTHeader_t* acpi_map(size_t phys) {
+    acpi_SDTHeader_t* t = (acpi_SDTHeader_t*)paging_mapIO(phys, sizeof(acpi_SDTHeader_t), PAGING_CACHE_WB);
+    if (t == NULL) { PANIC("Unable to map ACPI table at 0x%x", phys); }
+    return (acpi_SDTHeader_t*)paging_mapIO(phys, t->Length, PAGING_CACHE_WB);
+}
+
 // * Functions
 
 /**
@@ -54,7 +64,7 @@ void acpi_init() {
             }
             ncopy(acpiTable.OEMID, rsdp->OEMID, 6); acpiTable.support = true; // Get OEMID and mark table as ACPI supported
             acpi_SDTHeader_t* sdthead =     // Get SDT headers address
-                (acpi_SDTHeader_t*)(size_t)(acpiTable.Revision ? xsdp->XsdtAddress : rsdp->RsdtAddress);
+                acpi_map((size_t)(acpiTable.Revision ? xsdp->XsdtAddress : rsdp->RsdtAddress));
             // Check summary of SDT header
             uint8_t sum = 0; for (size_t i = 0; i < sdthead->Length; ++i) { sum += ((char *) sdthead)[i]; }
             if (sum != 0x00) { PANIC("SDT header damaged"); }       // If wrong, panic then
@@ -63,9 +73,9 @@ void acpi_init() {
             // Find FADT table
             for (int i = 0; i < sdtcount; ++i) {
                 // Get SDT header
-                acpi_SDTHeader_t* t = (acpi_SDTHeader_t*)othersdt[i];
+                acpi_SDTHeader_t* t = acpi_map(othersdt[i]);
                 // Check "FACP" signature and if correct, set as FADT on ACPI table
-                if (ncompare(t->Signature, "FACP", 4) == 0) { acpiTable.fadt = (acpi_FADT_t*)othersdt[i]; }
+                if (ncompare(t->Signature, "FACP", 4) == 0) { acpiTable.fadt = (acpi_FADT_t*)t; }
             } if (acpiTable.fadt == NULL) { PANIC("No FADT found"); }       // If not found, panic then
             if ((port_inw(acpiTable.fadt->PM1aControlBlock) & 1) == 0) {                // Check ACPI active bit
                 port_outb(acpiTable.fadt->SMI_CommandPort,acpiTable.fadt->AcpiEnable);  // If disable, active then
@@ -85,9 +95,9 @@ void acpi_init() {
             // Find MCFG table
             for (int i = 0; i < sdtcount; ++i) {
                 // Get SDT header
-                acpi_SDTHeader_t* t = (acpi_SDTHeader_t*)othersdt[i];
+                acpi_SDTHeader_t* t = acpi_map(othersdt[i]);
                 // Check "MCFG" signature and if correct, set as MCFG on ACPI table
-                if (ncompare(t->Signature, "MCFG", 4) == 0) { acpiTable.mcfg = (acpi_MCFG_t*)othersdt[i]; }
+                if (ncompare(t->Signature, "MCFG", 4) == 0) { acpiTable.mcfg = (acpi_MCFG_t*)t; }
             } break;    // Break the loop
         }
     } if (!acpiTable.support) { WARN("ACPI not supported"); }
@@ -3,6 +3,7 @@
 #include "kernel.h"
 #include "hw/port.h"
 #include "hw/acpi.h"
+#include "hw/paging.h"
 
 // * Types and structures
 
@@ -140,7 +141,9 @@ void devbus_get(devbus_Device_t* dev, uint8_t bus, uint8_t slot, uint8_t func) {
 void devbus_init() {
     if (devbus_InitLock) { return; } devbus_InitLock = true;    // Prevent re-initializing and lock the initializer
     if (acpiTable.mcfg != NULL) {                                           // Use express if MCFG table not NULL
-        devbus_PCIeBase = (void*)(size_t)acpiTable.mcfg->pciebase;              // Get PCIe base
+        devbus_PCIeBase = paging_mapIO((size_t)acpiTable.mcfg->pciebase,       // Map PCIe base as uncached
+            DEVBUS_MAX_BUSES << 20, PAGING_CACHE_UC);
+        if (devbus_PCIeBase == NULL) { PANIC("Unable to map PCIe configuration space"); }
         devbus_PCIeDevice_t* root = (devbus_PCIeDevice_t*)devbus_PCIeBase;      // Get root bridge
         // Do panic if root bridge not found or misconfigured
         if (root->vendor == (uint16_t)-1) { PANIC("PCIe root bridge not found or misconfigured"); }
@@ -1,6 +1,9 @@
 # Extern functions
 .extern interrupts_exceptionHandler     # Extern Exception Handler Function
+.extern interrupts_pageFault            # Extern Page Fault Handler Function
+.extern interrupts_doubleFault          # Extern Double Fault Handler Function
 .extern interrupts_setGate              # Extern IDT Set Gate Function
+.extern multitask_fpuTrap               # Extern FPU State Switch Function
 
 # Interrupt handlers for exceptions (0x00 to 0x1F)
 .global interrupts_exception0x00    # 0
@@ -75,17 +78,14 @@ interrupts_exception0x06:   # 6
     call interrupts_exceptionHandler
     addl $0x04, %esp
     ret
-interrupts_exception0x07:   # 7
-    pushl $0x07
-    call interrupts_exceptionHandler
-    addl $0x04, %esp
-    ret
-interrupts_exception0x08:   # 8
+interrupts_exception0x07:   # 7 (TS flag is set, switch FPU/SSE state to current process and retry)
+    pusha
+    cld
+    call multitask_fpuTrap
+    popa
     iret
-    pushl $0x08
-    call interrupts_exceptionHandler
-    addl $0x04, %esp
-    ret
+interrupts_exception0x08:   # 8 (double fault task, error code pushed on task stack by CPU)
+    call interrupts_doubleFault # Never returns
 interrupts_exception0x09:   # 9
     pushl $0x09
     call interrupts_exceptionHandler
@@ -111,11 +111,11 @@ interrupts_exception0x0D:   # 13
     call interrupts_exceptionHandler
     addl $0x04, %esp
     ret
-interrupts_exception0x0E:   # 14
-    pushl $0x0E
-    call interrupts_exceptionHandler
-    addl $0x04, %esp
-    ret
+interrupts_exception0x0E:   # 14 (page fault task, error code pushed on task stack by CPU)
+    call interrupts_pageFault   # Returns only if fault resolved
+    addl $0x04, %esp            # Remove error code
+    iret                        # Return to interrupted task
+    jmp interrupts_exception0x0E    # Next page fault continues from here
 interrupts_exception0x0F:   # 15
     pushl $0x0F
     call interrupts_exceptionHandler
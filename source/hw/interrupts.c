@@ -1,5 +1,8 @@
 #include "hw/interrupts.h"
 
+#include "hw/paging.h"
+#include "hw/protect.h"
+
 #include "kernel.h"
 
 // * Imported exception gates
@@ -38,6 +41,11 @@ extern void interrupts_exception0x1E(void);             // Security
 extern void interrupts_exception0x1F(void);             // Unknown
 extern void interrupts_exceptionInterruptsInit(void);   // Exception interrupts initializer
 
+// * Constants
+
+#define INTERRUPTS_FAULTSTACK   (16 * 1024)     // Stack size of page fault task
+#define INTERRUPTS_DOUBLESTACK  (4 * 1024)      // Stack size of double fault task
+
 // * Types and structures
 
 // IDT Entry Structure
@@ -67,6 +75,12 @@ interrupts_IDTEntry_t interrupts_IDTEntry[256];
 // Define the IDT Pointer
 interrupts_IDTPointer_t interrupts_IDTPointer;
 
+// Stack of page fault task
+uint8_t interrupts_FaultStack[INTERRUPTS_FAULTSTACK] __attribute__((aligned(16)));
+
+// Stack of double fault task
+uint8_t interrupts_DoubleStack[INTERRUPTS_DOUBLESTACK] __attribute__((aligned(16)));
+
 // List of exception messages to be displayed for each exception code
 static char* interrupts_exceptionMessage[] = {
     "Division Error",                       // 0
@@ -123,6 +137,24 @@ NORETURN void interrupts_exceptionHandler(uint8_t num) {
     }
 }
 
+// The page fault handler that gets called with error code (returns only if paging resolved the fault)
+void interrupts_pageFault(uint32_t code) {
+    size_t addr; asm volatile("movl %%cr2, %0" : "=r"(addr));
+    if (paging_fault(addr, code)) { return; }
+    ERR("Page fault at 0x%x (%s, %s, %s mode)", addr,
+        (code & PAGING_FAULT_PRESENT) ? "protection" : "not present",
+        (code & PAGING_FAULT_WRITE) ? "write" : "read",
+        (code & PAGING_FAULT_USER) ? "user" : "kernel");
+    interrupts_exceptionHandler(0x0E);
+}
+
+// The double fault handler, a page fault inside page fault task ends here (its task gate leads to a busy TSS)
+NORETURN void interrupts_doubleFault(void) {
+    size_t addr; asm volatile("movl %%cr2, %0" : "=r"(addr));
+    if (protect_faultTaskBusy()) { PANIC("Page fault at 0x%x inside page fault handler (nested)", addr); }
+    interrupts_exceptionHandler(0x08);
+}
+
 // * Functions
 
 /**
@@ -141,6 +173,21 @@ void interrupts_setGate(int num, size_t handler) {
     interrupts_IDTEntry[num].offset_high  = (addr >> 16) & 0xFFFF;          // High 16 bits of the handler
 }
 
+/**
+ * @brief Function for set task gate in the IDT for a specific interrupt
+ * 
+ * @param num Interrupt vector number
+ * @param selector Task state segment selector
+ */
+void interrupts_setTaskGate(int num, uint16_t selector) {
+    if (num < 0 || num >= 256 || !interrupts_InitLock) { return; }          // Prevent invalid vectors and uninit
+    interrupts_IDTEntry[num].offset_low   = 0x0000;                         // Unused
+    interrupts_IDTEntry[num].selector     = selector;                       // Task state segment selector
+    interrupts_IDTEntry[num].zero         = 0x00;                           // Unused
+    interrupts_IDTEntry[num].attributes   = 0x85;                           // Task gate
+    interrupts_IDTEntry[num].offset_high  = 0x0000;                         // Unused
+}
+
 /**
  * @brief Function for initialize interrupt manager
  */
@@ -150,6 +197,12 @@ void interrupts_init() {
     // Set default handler for all interrupt vectors
     for (int i = 0; i < 256; ++i) { interrupts_setGate(i, (size_t)interrupts_defaultHandler); }
     interrupts_exceptionInterruptsInit();                                       // Initialize exception handler
+    protect_setFaultTask((size_t)interrupts_exception0x0E,                      // Handle page faults in own task
+        (size_t)&interrupts_FaultStack[INTERRUPTS_FAULTSTACK]);                 // (faults on unmapped stacks)
+    interrupts_setTaskGate(0x0E, PROTECT_SEL_FAULTTASK);
+    protect_setDoubleTask((size_t)interrupts_exception0x08,                     // Handle double faults in own task
+        (size_t)&interrupts_DoubleStack[INTERRUPTS_DOUBLESTACK]);               // (fault stack may be broken)
+    interrupts_setTaskGate(0x08, PROTECT_SEL_DOUBLETASK);
     interrupts_IDTPointer.limit = (sizeof(interrupts_IDTEntry_t) * 256) - 1;    // Set the IDT size
     interrupts_IDTPointer.base = (size_t)&interrupts_IDTEntry;                  // Set the IDT base address
     asm volatile ("lidtl (%0)" : : "r" (&interrupts_IDTPointer));               // Load the IDT into the IDTR register
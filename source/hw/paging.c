@@ -0,0 +1,756 @@
+#include "hw/paging.h"
+
+#include "kernel.h"
+#include "hw/protect.h"
+
+// * Types and structures
+
+// Structure of memory-mapped I/O mapping
+typedef struct {
+    size_t phys;        // Physical base of mapping
+    size_t size;        // Size of mapping
+    size_t virt;        // Virtual base of mapping
+    uint8_t cache;      // Memory type of mapping
+} paging_IOMap_t;
+
+// Structure of demand-paged area (pages mapped on first touch)
+typedef struct {
+    size_t space;       // Address space of area (0 means every address space)
+    size_t base;        // Base of area (0 if slot empty)
+    size_t size;        // Size of area
+    uint32_t flags;     // Entry flags of pages
+    const uint8_t* data;    // Backing data of area start (null for demand-zero area)
+    size_t datasize;        // Size of backing data (rest of area is cleared)
+} paging_Area_t;
+
+// * Variables and tables
+
+bool paging_InitLock = false;           // Initialize lock for prevent re-initializing paging
+
+size_t paging_Kernel;                   // Kernel address space (value of CR3)
+paging_Entry_t* paging_Directory;       // Kernel page directories
+paging_Entry_t* paging_KMapTable;       // Page table of temporary mapping window
+void* paging_ZeroPage;                  // Shared cleared page (mapped read-only until first write)
+
+paging_IOMap_t paging_IOV[PAGING_IOSLOTS];  // Memory-mapped I/O mappings
+size_t paging_IOC;                          // Memory-mapped I/O mapping count
+size_t paging_IONext = PAGING_IOBASE;       // Next free address of memory-mapped I/O window
+
+uint32_t paging_VMMap[PAGING_VMPAGES / 32]; // Reserved pages of vmalloc area (set bit means reserved)
+size_t paging_VMHint;                       // Bitmap word to start next vmalloc area search
+
+paging_Area_t paging_AreaV[PAGING_AREASLOTS];   // Demand-paged areas
+
+size_t paging_SpaceV[PAGING_SPACESLOTS];        // Process address spaces
+size_t paging_PageV[PAGING_SPACESLOTS];         // Mapped user page count of process address spaces
+size_t paging_PeakV[PAGING_SPACESLOTS];         // High-water mark of mapped user page count
+
+// * Subfunctions
+
+// Function for convert a memory type into page table entry flags
+static uint32_t paging_cacheFlags(uint8_t cache, bool large) {
+    uint32_t flags = 0;
+    if (cache & 1) { flags |= PAGING_FLAG_PWT; }
+    if (cache & 2) { flags |= PAGING_FLAG_PCD; }
+    if ((cache & 4) && kernel_CPUInfo.has_pat) { flags |= large ? PAGING_FLAG_PDEPAT : PAGING_FLAG_PTEPAT; }
+    return flags;
+}
+
+// Function for check whether large pages are available (always with PAE)
+static inline bool paging_large(void) {
+#ifdef PAGING_PAE
+    return true;
+#else
+    return kernel_CPUInfo.has_pse;
+#endif
+}
+
+// Function for check whether an address is in process address space
+static inline bool paging_isUser(size_t virt) { return virt >= PAGING_USERBASE && virt < PAGING_USERLIMIT; }
+
+// Function for get page directories of an address space (PAE spaces start with page directory pointer table)
+static inline paging_Entry_t* paging_dirs(size_t space) {
+    return (paging_Entry_t*)(space + ((PAGING_SPACEFRAMES - 1) * PAGING_PAGESIZE));
+}
+
+// Function for get page directory which maps an address (process part from current, others from kernel)
+static paging_Entry_t* paging_dir(size_t virt) {
+    if (!paging_isUser(virt)) { return paging_Directory; }
+    size_t cr3; asm volatile("movl %%cr3, %0" : "=r"(cr3)); return paging_dirs(cr3);
+}
+
+// Function for set a page directory entry (kernel entries are copied to every address space)
+static void paging_setPDE(paging_Entry_t* dir, size_t virt, paging_Entry_t value) {
+    if (paging_isUser(virt)) { dir[virt >> PAGING_DIRSHIFT] = value; return; }
+    paging_Directory[virt >> PAGING_DIRSHIFT] = value;
+    for (int i = 0; i < PAGING_SPACESLOTS; ++i)
+        { if (paging_SpaceV[i]) { paging_dirs(paging_SpaceV[i])[virt >> PAGING_DIRSHIFT] = value; } }
+}
+
+// Function for get page table of a virtual address in a page directory (creates it if requested, returns null if not available)
+static paging_Entry_t* paging_table(paging_Entry_t* dir, size_t virt, bool create) {
+    paging_Entry_t* pde = &dir[virt >> PAGING_DIRSHIFT];
+    if (*pde & PAGING_FLAG_PRESENT) {
+        if (*pde & PAGING_FLAG_LARGE) { return NULL; }  // Covered by a large page
+        return (paging_Entry_t*)(size_t)(*pde & PAGING_ADDRMASK);
+    } if (!create) { return NULL; }
+    paging_Entry_t* table = (paging_Entry_t*)frame_allocZero();
+    if (table == NULL) { return NULL; }
+    // Page tables are identity mapped, entry flags limit access per page
+    paging_setPDE(dir, virt, (paging_Entry_t)(size_t)table | PAGING_FLAG_PRESENT | PAGING_FLAG_WRITE | PAGING_FLAG_USER);
+    return table;
+}
+
+// Function for translate a virtual address in a page directory (returns 0 if not mapped)
+static uint64_t paging_translate(paging_Entry_t* dir, size_t virt) {
+    paging_Entry_t pde = dir[virt >> PAGING_DIRSHIFT];
+    if (!(pde & PAGING_FLAG_PRESENT)) { return 0; }
+    if (pde & PAGING_FLAG_LARGE) { return (pde & PAGING_LARGEMASK) | (virt & (PAGING_LARGESIZE - 1)); }
+    paging_Entry_t pte = ((paging_Entry_t*)(size_t)(pde & PAGING_ADDRMASK))[(virt >> 12) & (PAGING_ENTRIES - 1)];
+    if (!(pte & PAGING_FLAG_PRESENT)) { return 0; }
+    return (pte & PAGING_ADDRMASK) | (virt & (PAGING_PAGESIZE - 1));
+}
+
+// Function for find slot of a process address space (returns -1 if not found)
+static int paging_slot(size_t space) {
+    for (int i = 0; i < PAGING_SPACESLOTS; ++i) { if (paging_SpaceV[i] == space) { return i; } }
+    return -1;
+}
+
+// Function for count user pages mapped into (or unmapped from) an address space
+static void paging_account(size_t space, int delta) {
+    int slot = paging_slot(space); if (slot == -1) { return; }
+    paging_PageV[slot] += delta;
+    if (paging_PageV[slot] > paging_PeakV[slot]) { paging_PeakV[slot] = paging_PageV[slot]; }
+}
+
+// Function for free frame of an unmapped page (shared zero page is never freed, high frames go back to high memory)
+static inline void paging_release(uint64_t phys) {
+    if (phys == 0 || phys == (size_t)paging_ZeroPage) { return; }
+    if (phys >= PAGING_IDENTLIMIT) { frame_freeHigh(phys); } else { frame_free((void*)(size_t)phys); }
+}
+
+// Function for invalidate TLB entry of a page
+static inline void paging_invalidate(size_t virt) { asm volatile("invlpg (%0)" : : "r"(virt) : "memory"); }
+
+// Function for reach a frame through a temporary mapping slot (identity mapped frames are returned as they are)
+// Slot 2 belongs to page fault task, slot table is always present so using a slot never faults
+static void* paging_kmap(uint64_t phys, int slot) {
+    if (phys < PAGING_IDENTLIMIT) { return (void*)(size_t)phys; }
+    size_t virt = PAGING_KMAPBASE + (slot * PAGING_PAGESIZE);
+    paging_KMapTable[slot] = (phys & PAGING_ADDRMASK) | PAGING_FLAG_PRESENT | PAGING_FLAG_WRITE;
+    paging_invalidate(virt);
+    return (void*)virt;
+}
+
+// Function for allocate a data frame, from high memory first (page tables and kernel objects stay in identity map)
+static uint64_t paging_allocData(bool clear, int slot) {
+    uint64_t phys = frame_allocHigh();
+    if (phys == 0) { return (size_t)(clear ? frame_allocZero() : frame_alloc()); }
+    if (clear) { fill(paging_kmap(phys, slot), 0, PAGING_PAGESIZE); }
+    return phys;
+}
+
+// Function for set (reserved) or clear (free) bits of a page run in vmalloc area, a word at a time
+static void paging_vmMark(size_t first, size_t count, bool reserve) {
+    while (count > 0) {
+        size_t bit = first & 31, n = 32 - bit; if (n > count) { n = count; }
+        uint32_t mask = (n == 32) ? 0xFFFFFFFF : (((1U << n) - 1) << bit);
+        if (reserve) { paging_VMMap[first >> 5] |= mask; } else { paging_VMMap[first >> 5] &= ~mask; }
+        first += n; count -= n;
+    }
+}
+
+// Function for find a free page run in vmalloc area by next fit (returns PAGING_VMPAGES if not found)
+static size_t paging_vmFind(size_t count) {
+    size_t words = PAGING_VMPAGES / 32, start = 0, run = 0;
+    for (size_t i = 0; i < words; ++i) {
+        size_t word = paging_VMHint + i; if (word >= words) { word -= words; }
+        if (word == 0) { run = 0; }     // Runs don't wrap around end of area
+        uint32_t bits = paging_VMMap[word];
+        if (bits == 0xFFFFFFFF) { run = 0; continue; }
+        if (bits == 0) {
+            if (run == 0) { start = word * 32; }
+            run += 32; if (run >= count) { break; } continue;
+        }
+        // Mixed word, continue bit by bit
+        for (size_t bit = 0; bit < 32 && run < count; ++bit) {
+            if (!(bits & (1U << bit))) { if (run++ == 0) { start = (word * 32) + bit; } } else { run = 0; }
+        } if (run >= count) { break; }
+    } if (run < count) { return PAGING_VMPAGES; }
+    paging_VMHint = (start + count) / 32; if (paging_VMHint >= words) { paging_VMHint = 0; }
+    return start;
+}
+
+// * Functions
+
+/**
+ * @brief Function for initialize paging (identity maps kernel space and enables paging)
+ */
+void paging_init() {
+    if (paging_InitLock) { return; }
+#ifdef PAGING_PAE
+    if (!kernel_CPUInfo.has_pae) { PANIC("PAE not supported"); }
+#endif
+    paging_Kernel = (size_t)frame_allocRun(PAGING_SPACEFRAMES);
+    if (paging_Kernel == 0) { PANIC("Out of memory"); }
+    fill((void*)paging_Kernel, 0, PAGING_SPACEFRAMES * PAGING_PAGESIZE);
+    paging_Directory = paging_dirs(paging_Kernel);
+#ifdef PAGING_PAE
+    // Page directory pointer table refers to 4 page directories following it
+    for (size_t i = 0; i < 4; ++i)
+        { ((uint64_t*)paging_Kernel)[i] = (uint64_t)(size_t)(paging_Directory + (i * PAGING_ENTRIES)) | PAGING_FLAG_PRESENT; }
+#endif
+    paging_ZeroPage = frame_alloc();
+    if (paging_ZeroPage == NULL) { PANIC("Out of memory"); }
+    fill(paging_ZeroPage, 0, PAGING_PAGESIZE);
+    paging_InitLock = true;
+
+    // Program the PAT before any mapping uses it (write-combining on last entry)
+    if (kernel_CPUInfo.has_pat) {
+        asm volatile("wbinvd" : : : "memory");
+        utils_wrmsr(PAGING_MSR_PAT, PAGING_PATVALUE);
+        asm volatile("wbinvd" : : : "memory");
+    }
+
+    // Identity map kernel space as global pages (large pages keep TLB pressure low)
+    for (size_t addr = 0; addr < PAGING_IDENTLIMIT; addr += PAGING_LARGESIZE) {
+        if (paging_large()) {
+            paging_Directory[addr >> PAGING_DIRSHIFT] = (paging_Entry_t)addr |
+                PAGING_FLAG_PRESENT | PAGING_FLAG_WRITE | PAGING_FLAG_LARGE | PAGING_FLAG_GLOBAL;
+            continue;
+        }
+        paging_Entry_t* table = paging_table(paging_Directory, addr, true);
+        if (table == NULL) { PANIC("Out of memory"); }
+        for (size_t i = 0; i < PAGING_ENTRIES; ++i) {
+            table[i] = (paging_Entry_t)(addr + (i * PAGING_PAGESIZE)) |
+                PAGING_FLAG_PRESENT | PAGING_FLAG_WRITE | PAGING_FLAG_GLOBAL;
+        }
+    }
+
+    // Page table of temporary mapping window is shared by every address space
+    paging_KMapTable = paging_table(paging_Directory, PAGING_KMAPBASE, true);
+    if (paging_KMapTable == NULL) { PANIC("Out of memory"); }
+    paging_Directory[PAGING_KMAPBASE >> PAGING_DIRSHIFT] &= ~(paging_Entry_t)PAGING_FLAG_USER;
+
+    // Load page directory and enable paging
+    uint32_t cr4; asm volatile("movl %%cr4, %0" : "=r"(cr4));
+    if (kernel_CPUInfo.has_pse) { cr4 |= (1 << 4); }    // PSE bit
+#ifdef PAGING_PAE
+    cr4 |= (1 << 5);                                    // PAE bit
+#endif
+    asm volatile("movl %0, %%cr4" : : "r"(cr4));
+    asm volatile("movl %0, %%cr3" : : "r"(paging_Kernel) : "memory");
+    protect_setTaskCR3(paging_Kernel);
+    uint32_t cr0; asm volatile("movl %%cr0, %0" : "=r"(cr0));
+    cr0 |= (1U << 31) | (1 << 16);                      // PG and WP bits
+    asm volatile("movl %0, %%cr0" : : "r"(cr0) : "memory");
+    if (kernel_CPUInfo.has_pge) { cr4 |= (1 << 7); asm volatile("movl %0, %%cr4" : : "r"(cr4)); }  // PGE bit
+}
+
+/**
+ * @brief Function for map a small page
+ * 
+ * @param virt Virtual address of page
+ * @param phys Physical address of page
+ * @param flags Entry flags of page (present flag added automatically)
+ * 
+ * @return Mapped or not (true/false)
+ */
+bool paging_map(size_t virt, uint64_t phys, uint32_t flags) {
+    if (!paging_InitLock) { return false; }
+    paging_Entry_t* table = paging_table(paging_dir(virt), virt, true);
+    if (table == NULL) { return false; }
+    paging_Entry_t* pte = &table[(virt >> 12) & (PAGING_ENTRIES - 1)];
+    if (paging_isUser(virt) && !(*pte & PAGING_FLAG_PRESENT)) { paging_account(paging_current(), 1); }
+    *pte = (phys & PAGING_ADDRMASK) | flags | PAGING_FLAG_PRESENT;
+    paging_invalidate(virt);
+    return true;
+}
+
+/**
+ * @brief Function for unmap a small page
+ * 
+ * @param virt Virtual address of page
+ * 
+ * @return Physical address of unmapped page (0 if not mapped)
+ */
+uint64_t paging_unmap(size_t virt) {
+    if (!paging_InitLock) { return 0; }
+    paging_Entry_t* table = paging_table(paging_dir(virt), virt, false);
+    if (table == NULL) { return 0; }
+    paging_Entry_t* pte = &table[(virt >> 12) & (PAGING_ENTRIES - 1)];
+    if (!(*pte & PAGING_FLAG_PRESENT)) { return 0; }
+    uint64_t phys = *pte & PAGING_ADDRMASK;
+    if (paging_isUser(virt)) { paging_account(paging_current(), -1); }
+    *pte = 0; paging_invalidate(virt);
+    return phys;
+}
+
+/**
+ * @brief Function for translate a virtual address into physical address
+ * 
+ * @param virt Virtual address
+ * 
+ * @return Physical address (0 if not mapped)
+ */
+uint64_t paging_phys(size_t virt) {
+    if (!paging_InitLock) { return virt; }
+    return paging_translate(paging_dir(virt), virt);
+}
+
+/**
+ * @brief Function for map a physical range (device memory or firmware tables) with a memory type
+ * (only pages of range get the type, large pages are used where range covers them fully)
+ * 
+ * @param phys Physical address of range
+ * @param size Size of range
+ * @param cache Memory type of range (PAGING_CACHE_*)
+ * 
+ * @return Virtual address of range (If not available, returns null)
+ */
+void* paging_mapIO(size_t phys, size_t size, uint8_t cache) {
+    if (size == 0 || phys + size < phys) { return NULL; }
+    // Ordinary memory in kernel space is already reachable
+    if (!paging_InitLock || (cache == PAGING_CACHE_WB && phys + size <= PAGING_IDENTLIMIT)) { return (void*)phys; }
+    // Reuse an existing mapping which covers the range
+    for (size_t i = 0; i < paging_IOC; ++i) {
+        paging_IOMap_t* m = &paging_IOV[i];
+        if (m->cache == cache && phys >= m->phys && phys + size <= m->phys + m->size)
+            { return (void*)(m->virt + (phys - m->phys)); }
+    } if (paging_IOC >= PAGING_IOSLOTS) { return NULL; }
+    // Identity map reaches memory below its limit as write-back too, mixed memory types of same memory are undefined
+    if (cache != PAGING_CACHE_WB && phys < PAGING_IDENTLIMIT)
+        { WARN("Physical range 0x%x-0x%x mapped with a second memory type", phys, phys + size - 1); }
+    size_t base = phys & ~(PAGING_PAGESIZE - 1), end = ALIGN(phys + size, PAGING_PAGESIZE);
+    // Large pages need same offset in large page on both sides, so virtual base follows physical one
+    bool large = paging_large() && ALIGN(base, PAGING_LARGESIZE) + PAGING_LARGESIZE <= end;
+    size_t virt = large ? ALIGN(paging_IONext, PAGING_LARGESIZE) + (base & (PAGING_LARGESIZE - 1)) : paging_IONext;
+    if (virt < paging_IONext || end - base > PAGING_IOLIMIT - virt) { return NULL; }
+    for (size_t addr = base; addr < end;) {
+        size_t at = virt + (addr - base);
+        if (large && !(addr & (PAGING_LARGESIZE - 1)) && end - addr >= PAGING_LARGESIZE) {
+            paging_setPDE(paging_Directory, at, (paging_Entry_t)addr | paging_cacheFlags(cache, true) |
+                PAGING_FLAG_PRESENT | PAGING_FLAG_WRITE | PAGING_FLAG_LARGE | PAGING_FLAG_GLOBAL);
+            paging_invalidate(at); addr += PAGING_LARGESIZE;
+        } else if (paging_map(at, addr, paging_cacheFlags(cache, false) | PAGING_FLAG_WRITE | PAGING_FLAG_GLOBAL)) {
+            addr += PAGING_PAGESIZE;
+        } else { return NULL; }
+    }
+    paging_IONext = virt + (end - base);
+    paging_IOV[paging_IOC].phys = base; paging_IOV[paging_IOC].size = end - base;
+    paging_IOV[paging_IOC].virt = virt; paging_IOV[paging_IOC].cache = cache; ++paging_IOC;
+    return (void*)(virt + (phys - base));
+}
+
+/**
+ * @brief Function for allocate virtually contiguous memory from scattered page frames
+ * 
+ * @param size Size of memory
+ * 
+ * @return Address of allocated memory (If not available, returns null)
+ */
+void* vmalloc(size_t size) {
+    if (!paging_InitLock || size == 0 || size > PAGING_VMLIMIT - PAGING_VMBASE) { return NULL; }
+    size_t count = (size + PAGING_PAGESIZE - 1) / PAGING_PAGESIZE;
+    // Reserve one more page as unmapped guard (marks end of area and catches overruns)
+    size_t first = paging_vmFind(count + 1);
+    if (first == PAGING_VMPAGES) { return NULL; }
+    paging_vmMark(first, count + 1, true);
+    size_t base = PAGING_VMBASE + (first * PAGING_PAGESIZE);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t frame = paging_allocData(false, 0);
+        if (frame == 0 || !paging_map(base + (i * PAGING_PAGESIZE), frame, PAGING_FLAG_WRITE | PAGING_FLAG_GLOBAL)) {
+            paging_release(frame);
+            while (i-- > 0) { paging_release(paging_unmap(base + (i * PAGING_PAGESIZE))); }
+            paging_vmMark(first, count + 1, false);
+            return NULL;
+        }
+    } return (void*)base;
+}
+
+/**
+ * @brief Function for free memory allocated by vmalloc
+ * 
+ * @param addr Address of memory
+ */
+void vfree(void* addr) {
+    size_t base = (size_t)addr;
+    if (!paging_InitLock || base < PAGING_VMBASE || base >= PAGING_VMLIMIT || (base & (PAGING_PAGESIZE - 1))) { return; }
+    size_t first = (base - PAGING_VMBASE) / PAGING_PAGESIZE;
+    if (first > 0 && paging_phys(base - PAGING_PAGESIZE) != 0) { return; }     // invalid free (not start of area)
+    // Unmap pages until guard page of area
+    size_t count = 0; uint64_t phys;
+    while (base + (count * PAGING_PAGESIZE) < PAGING_VMLIMIT &&
+        (phys = paging_unmap(base + (count * PAGING_PAGESIZE))) != 0) { paging_release(phys); ++count; }
+    if (count > 0) { paging_vmMark(first, count + 1, false); }
+}
+
+/**
+ * @brief Function for allocate virtually contiguous demand-zero memory
+ * (pages map shared zero page and take a cleared frame on first write)
+ * 
+ * @param size Size of memory
+ * 
+ * @return Address of allocated memory (If not available, returns null)
+ */
+void* vzalloc(size_t size) {
+    if (!paging_InitLock || size == 0 || size > PAGING_VMLIMIT - PAGING_VMBASE) { return NULL; }
+    size_t count = (size + PAGING_PAGESIZE - 1) / PAGING_PAGESIZE;
+    size_t first = paging_vmFind(count + 1);
+    if (first == PAGING_VMPAGES) { return NULL; }
+    paging_vmMark(first, count + 1, true);
+    size_t base = PAGING_VMBASE + (first * PAGING_PAGESIZE);
+    for (size_t i = 0; i < count; ++i) {
+        if (!paging_map(base + (i * PAGING_PAGESIZE), (size_t)paging_ZeroPage, PAGING_FLAG_COW | PAGING_FLAG_GLOBAL)) {
+            while (i-- > 0) { paging_release(paging_unmap(base + (i * PAGING_PAGESIZE))); }
+            paging_vmMark(first, count + 1, false);
+            return NULL;
+        }
+    } return (void*)base;
+}
+
+/**
+ * @brief Function for get size of memory allocated by vmalloc or vzalloc
+ * 
+ * @param addr Address of memory
+ * 
+ * @return Size of memory (0 if not allocated)
+ */
+size_t vsize(void* addr) {
+    size_t base = (size_t)addr, size = 0;
+    if (!paging_InitLock || base < PAGING_VMBASE || base >= PAGING_VMLIMIT || (base & (PAGING_PAGESIZE - 1))) { return 0; }
+    while (base + size < PAGING_VMLIMIT && paging_phys(base + size) != 0) { size += PAGING_PAGESIZE; }
+    return size;
+}
+
+/**
+ * @brief Function for create a process address space (shares kernel mappings)
+ * 
+ * @return Address space (value of CR3, 0 means failure)
+ */
+size_t paging_createSpace() {
+    if (!paging_InitLock) { return 0; }
+    int slot = paging_slot(0); if (slot == -1) { return 0; }
+    size_t space = (size_t)frame_allocRun(PAGING_SPACEFRAMES); if (space == 0) { return 0; }
+    paging_Entry_t* dir = paging_dirs(space);
+    ncopy(dir, paging_Directory, PAGING_DIRENTRIES * sizeof(paging_Entry_t));
+    fill(&dir[PAGING_USERBASE >> PAGING_DIRSHIFT], 0,
+        ((PAGING_USERLIMIT - PAGING_USERBASE) >> PAGING_DIRSHIFT) * sizeof(paging_Entry_t));
+#ifdef PAGING_PAE
+    for (size_t i = 0; i < 4; ++i) { ((uint64_t*)space)[i] = (uint64_t)(size_t)(dir + (i * PAGING_ENTRIES)) | PAGING_FLAG_PRESENT; }
+#endif
+    paging_SpaceV[slot] = space; paging_PageV[slot] = paging_PeakV[slot] = 0;
+    return space;
+}
+
+/**
+ * @brief Function for clone a process address space (pages are shared read-only and copied on first write)
+ * 
+ * @param space Address space to clone
+ * 
+ * @return Address space of clone (0 means failure)
+ */
+size_t paging_cloneSpace(size_t space) {
+    if (!paging_InitLock || paging_slot(space) == -1) { return 0; }
+    size_t clone = paging_createSpace(); if (clone == 0) { return 0; }
+    paging_Entry_t *from = paging_dirs(space), *to = paging_dirs(clone);
+    for (size_t pd = PAGING_USERBASE >> PAGING_DIRSHIFT; pd < PAGING_USERLIMIT >> PAGING_DIRSHIFT; ++pd) {
+        if (!(from[pd] & PAGING_FLAG_PRESENT)) { continue; }
+        paging_Entry_t* src = (paging_Entry_t*)(size_t)(from[pd] & PAGING_ADDRMASK);
+        paging_Entry_t* dst = (paging_Entry_t*)frame_allocZero(); if (dst == NULL) { paging_destroySpace(clone); return 0; }
+        to[pd] = (paging_Entry_t)(size_t)dst | (from[pd] & ~PAGING_ADDRMASK);
+        for (size_t i = 0; i < PAGING_ENTRIES; ++i) {
+            if (!(src[i] & PAGING_FLAG_PRESENT)) { continue; }
+            uint64_t frame = src[i] & PAGING_ADDRMASK; paging_account(clone, 1);
+            // Zero page and not owned frames are never freed, no reference needed
+            if (frame == (size_t)paging_ZeroPage || (src[i] & PAGING_FLAG_SHARED)) { dst[i] = src[i]; continue; }
+            if (frame < PAGING_IDENTLIMIT && frame_share((void*)(size_t)frame)) {
+                // Both sides lose write access, first write fault takes a private copy
+                if (src[i] & (PAGING_FLAG_WRITE | PAGING_FLAG_COW)) { src[i] = (src[i] & ~PAGING_FLAG_WRITE) | PAGING_FLAG_COW; }
+                dst[i] = src[i]; continue;
+            }
+            // Frames from outside the pool (high memory included) can't be shared, copy them now
+            uint64_t copy = paging_allocData(false, 0); if (copy == 0) { paging_destroySpace(clone); return 0; }
+            ncopy(paging_kmap(copy, 0), paging_kmap(frame, 1), PAGING_PAGESIZE);
+            dst[i] = copy | (src[i] & ~PAGING_ADDRMASK);
+        }
+    }
+    // Untouched pages of demand-paged areas are resolved same way in clone
+    for (int i = 0; i < PAGING_AREASLOTS; ++i) {
+        paging_Area_t* a = &paging_AreaV[i]; if (a->base == 0 || a->space != space) { continue; }
+        if (!paging_addArea(clone, a->base, a->size, a->flags, a->data, a->datasize)) { paging_destroySpace(clone); return 0; }
+    }
+    // Drop stale writable entries of source (user pages are not global)
+    if (space == paging_current()) { asm volatile("movl %0, %%cr3" : : "r"(space) : "memory"); }
+    return clone;
+}
+
+/**
+ * @brief Function for destroy a process address space with its page tables and pages
+ * 
+ * @param space Address space (must not be current)
+ */
+void paging_destroySpace(size_t space) {
+    if (!paging_InitLock || space == 0 || space == paging_Kernel) { return; }
+    int slot = paging_slot(space); if (slot == -1) { return; }
+    paging_Entry_t* dir = paging_dirs(space); paging_SpaceV[slot] = 0;
+    for (int i = 0; i < PAGING_AREASLOTS; ++i) { if (paging_AreaV[i].space == space) { paging_AreaV[i].base = 0; } }
+    for (size_t pd = PAGING_USERBASE >> PAGING_DIRSHIFT; pd < PAGING_USERLIMIT >> PAGING_DIRSHIFT; ++pd) {
+        if (!(dir[pd] & PAGING_FLAG_PRESENT)) { continue; }
+        paging_Entry_t* table = (paging_Entry_t*)(size_t)(dir[pd] & PAGING_ADDRMASK);
+        // Shared frames only lose a reference
+        for (size_t i = 0; i < PAGING_ENTRIES; ++i) {
+            if ((table[i] & PAGING_FLAG_PRESENT) && !(table[i] & PAGING_FLAG_SHARED))
+                { paging_release(table[i] & PAGING_ADDRMASK); }
+        }
+        frame_free(table);
+    } frame_freeRun((void*)space, PAGING_SPACEFRAMES);
+}
+
+/**
+ * @brief Function for switch to an address space (kernel mappings are global, so they stay in TLB)
+ * 
+ * @param space Address space
+ */
+void paging_switch(size_t space) {
+    if (!paging_InitLock || space == 0) { return; }
+    asm volatile("movl %0, %%cr3" : : "r"(space) : "memory");
+    protect_setTaskCR3(space);      // Page faults are resolved in faulting address space
+}
+
+/**
+ * @brief Function for get current address space
+ * 
+ * @return Address space
+ */
+size_t paging_current() { size_t cr3; asm volatile("movl %%cr3, %0" : "=r"(cr3)); return cr3; }
+
+/**
+ * @brief Function for get kernel address space
+ * 
+ * @return Address space
+ */
+size_t paging_kernelSpace() { return paging_Kernel; }
+
+/**
+ * @brief Function for map cleared pages to unmapped parts of a range in an address space
+ * 
+ * @param space Address space
+ * @param virt Base of range (in process address space)
+ * @param size Size of range
+ * @param flags Entry flags of pages
+ * 
+ * @return Mapped or not (true/false)
+ */
+bool paging_mapRange(size_t space, size_t virt, size_t size, uint32_t flags) {
+    if (!paging_InitLock || size == 0 || !paging_isUser(virt) || size > PAGING_USERLIMIT - virt) { return false; }
+    paging_Entry_t* dir = paging_dirs(space);
+    for (size_t addr = virt & ~(PAGING_PAGESIZE - 1); addr < virt + size; addr += PAGING_PAGESIZE) {
+        if (paging_translate(dir, addr) != 0) { continue; }
+        paging_Entry_t* table = paging_table(dir, addr, true); if (table == NULL) { return false; }
+        uint64_t frame = paging_allocData(true, 0); if (frame == 0) { return false; }
+        table[(addr >> 12) & (PAGING_ENTRIES - 1)] = frame | flags | PAGING_FLAG_PRESENT; paging_account(space, 1);
+        if (space == paging_current()) { paging_invalidate(addr); }
+    } return true;
+}
+
+/**
+ * @brief Function for copy data into mapped pages of an address space (frames are reached through kernel mappings)
+ * 
+ * @param space Address space
+ * @param virt Destination address (in process address space)
+ * @param src Source data (in kernel space)
+ * @param size Size of data
+ * 
+ * @return Copied or not (true/false)
+ */
+bool paging_copyTo(size_t space, size_t virt, const void* src, size_t size) {
+    if (!paging_InitLock || !paging_isUser(virt) || size > PAGING_USERLIMIT - virt) { return false; }
+    while (size > 0) {
+        uint64_t phys = paging_translate(paging_dirs(space), virt); if (phys == 0) { return false; }
+        size_t n = PAGING_PAGESIZE - (virt & (PAGING_PAGESIZE - 1)); if (n > size) { n = size; }
+        ncopy((uint8_t*)paging_kmap(phys, 0) + (virt & (PAGING_PAGESIZE - 1)), src, n);
+        virt += n; src = (const uint8_t*)src + n; size -= n;
+    } return true;
+}
+
+/**
+ * @brief Function for get mapped page count of a process address space (shared pages counted too)
+ * 
+ * @param space Address space
+ * @param peak High-water mark of mapped page count to write (can be null)
+ * 
+ * @return Mapped page count
+ */
+size_t paging_usage(size_t space, size_t* peak) {
+    int slot = paging_InitLock ? paging_slot(space) : -1;
+    if (peak != NULL) { *peak = (slot == -1) ? 0 : paging_PeakV[slot]; }
+    return (slot == -1) ? 0 : paging_PageV[slot];
+}
+
+/**
+ * @brief Function for map a page into an address space (ownership of frame is handled by caller)
+ * 
+ * @param space Address space
+ * @param virt Virtual address of page (in process address space)
+ * @param phys Physical address of page
+ * @param flags Entry flags of page (present flag added automatically)
+ * 
+ * @return Mapped or not (true/false)
+ */
+bool paging_mapPage(size_t space, size_t virt, uint64_t phys, uint32_t flags) {
+    if (!paging_InitLock || !paging_isUser(virt)) { return false; }
+    paging_Entry_t* table = paging_table(paging_dirs(space), virt, true); if (table == NULL) { return false; }
+    paging_Entry_t* pte = &table[(virt >> 12) & (PAGING_ENTRIES - 1)];
+    if (!(*pte & PAGING_FLAG_PRESENT)) { paging_account(space, 1); }
+    *pte = (phys & PAGING_ADDRMASK) | flags | PAGING_FLAG_PRESENT;
+    if (space == paging_current()) { paging_invalidate(virt); }
+    return true;
+}
+
+/**
+ * @brief Function for unmap a range of an address space (owned frames are freed or lose a reference)
+ * 
+ * @param space Address space
+ * @param virt Base of range (in process address space)
+ * @param size Size of range
+ */
+void paging_unmapRange(size_t space, size_t virt, size_t size) {
+    if (!paging_InitLock || !paging_isUser(virt) || size > PAGING_USERLIMIT - virt) { return; }
+    for (size_t addr = virt & ~(PAGING_PAGESIZE - 1); addr < virt + size; addr += PAGING_PAGESIZE) {
+        paging_Entry_t* table = paging_table(paging_dirs(space), addr, false);
+        if (table == NULL) { addr |= PAGING_LARGESIZE - PAGING_PAGESIZE; continue; }   // Skip to next page table
+        paging_Entry_t* pte = &table[(addr >> 12) & (PAGING_ENTRIES - 1)];
+        if (!(*pte & PAGING_FLAG_PRESENT)) { continue; }
+        if (!(*pte & PAGING_FLAG_SHARED)) { paging_release(*pte & PAGING_ADDRMASK); }
+        *pte = 0; paging_account(space, -1); if (space == paging_current()) { paging_invalidate(addr); }
+    }
+}
+
+/**
+ * @brief Function for find a free range in file mapping window of an address space (first fit, guard page between ranges)
+ * 
+ * @param space Address space
+ * @param size Size of range
+ * 
+ * @return Base of range (0 if not found)
+ */
+size_t paging_findRange(size_t space, size_t size) {
+    if (!paging_InitLock || size == 0 || size > PAGING_USERSTACK - PAGING_MMAPBASE) { return 0; }
+    size_t need = ALIGN(size, PAGING_PAGESIZE), start = PAGING_MMAPBASE, limit = PAGING_USERSTACK - PAGING_PAGESIZE;
+    for (size_t addr = PAGING_MMAPBASE; addr < limit && start + need + PAGING_PAGESIZE > addr; addr += PAGING_PAGESIZE) {
+        if (!(paging_dirs(space)[addr >> PAGING_DIRSHIFT] & PAGING_FLAG_PRESENT))
+            { addr |= PAGING_LARGESIZE - PAGING_PAGESIZE; continue; }     // Whole page table is free
+        if (paging_translate(paging_dirs(space), addr) != 0) { start = addr + (2 * PAGING_PAGESIZE); }
+    } return (start < limit && limit - start >= need) ? start : 0;
+}
+
+/**
+ * @brief Function for register a demand-paged area (pages are mapped on first touch, page below is a guard)
+ * 
+ * @param space Address space of area (0 means every address space)
+ * @param base Base of area (page aligned)
+ * @param size Size of area
+ * @param flags Entry flags of pages (with PAGING_FLAG_SHARED, page aligned data is mapped directly)
+ * @param data Backing data of area start (rest of area is cleared, null for demand-zero area)
+ * @param datasize Size of backing data
+ * 
+ * @return Registered or not (true/false)
+ */
+bool paging_addArea(size_t space, size_t base, size_t size, uint32_t flags, const void* data, size_t datasize) {
+    if (!paging_InitLock || base == 0 || size == 0 || (base & (PAGING_PAGESIZE - 1))) { return false; }
+    for (int i = 0; i < PAGING_AREASLOTS; ++i) {
+        paging_Area_t* a = &paging_AreaV[i]; if (a->base != 0) { continue; }
+        a->space = space; a->base = base; a->size = ALIGN(size, PAGING_PAGESIZE); a->flags = flags;
+        a->data = (const uint8_t*)data; a->datasize = data ? (datasize < a->size ? datasize : a->size) : 0;
+        return true;
+    } return false;
+}
+
+/**
+ * @brief Function for unregister a demand-paged area (pages of a single address space are unmapped too)
+ * 
+ * @param space Address space of area (0 means every address space)
+ * @param base Base of area
+ */
+void paging_removeArea(size_t space, size_t base) {
+    for (int i = 0; i < PAGING_AREASLOTS; ++i) {
+        paging_Area_t* a = &paging_AreaV[i];
+        if (a->base != base || a->space != space || base == 0) { continue; }
+        if (space != 0) { paging_unmapRange(space, base, a->size); }
+        a->base = 0; return;
+    }
+}
+
+/**
+ * @brief Function for try to resolve a page fault
+ * (runs in page fault task, which cannot nest: any page fault raised here, also through a kmap slot or an area
+ * data pointer, ends in double fault task which panics with its address, so everything touched must be mapped)
+ * 
+ * @param addr Faulting address
+ * @param code Page fault error code
+ * 
+ * @return Resolved or not (true/false)
+ */
+bool paging_fault(size_t addr, uint32_t code) {
+    if (!paging_InitLock) { return false; }
+    if (code & PAGING_FAULT_PRESENT) {
+        if (!(code & PAGING_FAULT_WRITE)) { return false; }
+        // Write to a copy-on-write page, take a private copy unless it is not shared anymore
+        paging_Entry_t* table = paging_table(paging_dir(addr), addr, false); if (table == NULL) { return false; }
+        paging_Entry_t* pte = &table[(addr >> 12) & (PAGING_ENTRIES - 1)];
+        if (!(*pte & PAGING_FLAG_COW)) { return false; }
+        uint64_t frame = *pte & PAGING_ADDRMASK;
+        if (frame == (size_t)paging_ZeroPage) {
+            uint64_t copy = paging_allocData(true, 2); if (copy == 0) { return false; }
+            *pte = copy | (*pte & ~PAGING_ADDRMASK);
+        } else if ((*pte & PAGING_FLAG_SHARED) || (frame < PAGING_IDENTLIMIT && frame_refs((void*)(size_t)frame) > 0)) {
+            // Old frame is still mapped (read-only) at faulting page
+            uint64_t copy = paging_allocData(false, 2); if (copy == 0) { return false; }
+            ncopy(paging_kmap(copy, 2), (void*)(addr & ~(PAGING_PAGESIZE - 1)), PAGING_PAGESIZE);
+            if (!(*pte & PAGING_FLAG_SHARED)) { paging_release(frame); }     // Drops a reference
+            *pte = copy | (*pte & ~(PAGING_ADDRMASK | PAGING_FLAG_SHARED));
+        } *pte = (*pte & ~PAGING_FLAG_COW) | PAGING_FLAG_WRITE;
+        paging_invalidate(addr);
+        return true;
+    }
+    // Collect areas of current address space which cover faulting page (segments may share a page)
+    size_t page = addr & ~(PAGING_PAGESIZE - 1), space = paging_current();
+    paging_Area_t* only = NULL; uint32_t flags = 0; size_t count = 0;
+    for (int i = 0; i < PAGING_AREASLOTS; ++i) {
+        paging_Area_t* a = &paging_AreaV[i];
+        if (a->base == 0 || (a->space != 0 && a->space != space)) { continue; }
+        if (page < a->base || page >= a->base + a->size) { continue; }
+        only = a; flags |= a->flags; ++count;
+    }
+    if (count == 0) {
+        for (int i = 0; i < PAGING_AREASLOTS; ++i) {
+            paging_Area_t* a = &paging_AreaV[i];
+            if (a->base == 0 || (a->space != 0 && a->space != space)) { continue; }
+            if (page == a->base - PAGING_PAGESIZE) { ERR("Guard page hit below area at 0x%x (overflow)", a->base); }
+        } return false;
+    }
+    // Map backing data directly if it covers whole page (writes take a private copy)
+    size_t off = page - only->base;
+    if (count == 1 && (only->flags & PAGING_FLAG_SHARED) && off + PAGING_PAGESIZE <= only->datasize &&
+        !(((size_t)only->data + off) & (PAGING_PAGESIZE - 1))) {
+        uint64_t phys = paging_phys((size_t)only->data + off);
+        if (phys != 0) {
+            if (flags & PAGING_FLAG_WRITE) { flags = (flags & ~PAGING_FLAG_WRITE) | PAGING_FLAG_COW; }
+            return paging_map(page, phys, flags);
+        }
+    }
+    // Else map a cleared frame and copy backing data of every covering area
+    uint64_t frame = paging_allocData(true, 2); if (frame == 0) { return false; }
+    uint8_t* dst = (uint8_t*)paging_kmap(frame, 2);
+    for (int i = 0; i < PAGING_AREASLOTS; ++i) {
+        paging_Area_t* a = &paging_AreaV[i];
+        if (a->base == 0 || a->data == NULL || (a->space != 0 && a->space != space)) { continue; }
+        if (page < a->base || page >= a->base + a->datasize) { continue; }
+        size_t from = page - a->base, n = a->datasize - from; if (n > PAGING_PAGESIZE) { n = PAGING_PAGESIZE; }
+        ncopy(dst, a->data + from, n);
+    }
+    if (!paging_map(page, frame, flags & ~PAGING_FLAG_SHARED)) { paging_release(frame); return false; }
+    return true;
+}
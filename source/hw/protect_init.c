@@ -25,12 +25,30 @@ typedef struct {
     uint32_t base;              // The starting address of the GDT in memory
 } PACKED protect_GDTPointer_t;  // 'packed' ensures no padding is added
 
+// Task State Segment (TSS) Structure
+// Holds the state of a hardware task (used for page faults, which need their own stack)
+typedef struct {
+    uint32_t link;              // Previous task selector (back link of nested task)
+    uint32_t esp0, ss0;         // Stack for ring 0
+    uint32_t esp1, ss1;         // Stack for ring 1
+    uint32_t esp2, ss2;         // Stack for ring 2
+    uint32_t cr3;               // Page directory of task
+    uint32_t eip, eflags;       // Instruction pointer and flags
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;    // General registers
+    uint32_t es, cs, ss, ds, fs, gs;                    // Segment registers
+    uint32_t ldt;               // Local descriptor table selector
+    uint16_t trap, iomap;       // Debug trap flag and I/O permission bitmap offset
+} PACKED protect_TSS_t;         // 'packed' ensures no padding is added
+
 // * Variables and tables
 
 bool protect_InitLock = false;      // Initialize lock for prevent re-initializing protected mode
 
 // Declare an array of GDT Entries.
-protect_GDTEntry_t protect_GDTEntry[3];     // Null, Code, Data
+protect_GDTEntry_t protect_GDTEntry[6];     // Null, Code, Data, Kernel task, Page fault task, Double fault task
+
+// Task state segments of kernel (current task), page fault task and double fault task
+protect_TSS_t protect_TaskTSS, protect_FaultTSS, protect_DoubleTSS;
 
 // Declare a GDT Pointer to store the base and limit of the GDT
 protect_GDTPointer_t protect_GDTPointer;
@@ -56,6 +74,15 @@ void protect_setGDTEntry (
     protect_GDTEntry[num].access       = access;                // Set the access flags (defines the segment's permissions)
 }
 
+// Function for set up a kernel mode task with interrupts disabled in current address space
+static void protect_setTask(protect_TSS_t* tss, size_t entry, size_t stack) {
+    tss->eip = entry; tss->esp = stack;
+    tss->eflags = 0x2;  // Interrupts disabled
+    tss->cs = PROTECT_SEL_CODE;
+    tss->ds = tss->es = tss->ss = tss->fs = tss->gs = PROTECT_SEL_DATA;
+    asm volatile ("movl %%cr3, %0" : "=r" (tss->cr3));
+}
+
 // * Functions
 
 // Function for initialize the Global Descriptor Table (GDT)
@@ -64,7 +91,7 @@ void protect_init() {
     protect_InitLock = true;            // Lock the initializer
     
     // Set the size of the GDT (total size of all entries minus one)
-    protect_GDTPointer.limit = (sizeof(protect_GDTEntry_t) * 3) - 1;
+    protect_GDTPointer.limit = (sizeof(protect_GDTEntry_t) * 6) - 1;
     // Set the base address of the GDT (the address of gdt_entry array)
     protect_GDTPointer.base = (uint32_t)&protect_GDTEntry;
 
@@ -74,6 +101,11 @@ void protect_init() {
     protect_setGDTEntry(1, 0, 0xFFFFFFFF, 0x9A, 0xCF);
     // Set up the Data Segment (index 2) with a base address of 0, 4GB size, access flags, and granularity
     protect_setGDTEntry(2, 0, 0xFFFFFFFF, 0x92, 0xCF);
+    // Set up the Task State Segments (index 3 to 5) as available 32-bit TSS with byte granularity
+    protect_TaskTSS.iomap = protect_FaultTSS.iomap = protect_DoubleTSS.iomap = sizeof(protect_TSS_t);
+    protect_setGDTEntry(3, (uint32_t)&protect_TaskTSS, sizeof(protect_TSS_t) - 1, 0x89, 0x00);
+    protect_setGDTEntry(4, (uint32_t)&protect_FaultTSS, sizeof(protect_TSS_t) - 1, 0x89, 0x00);
+    protect_setGDTEntry(5, (uint32_t)&protect_DoubleTSS, sizeof(protect_TSS_t) - 1, 0x89, 0x00);
 
     // uint32_t base  = 0x00200000;
     // uint32_t limit = 0x00800000 - 1;  // 8MB
@@ -84,4 +116,37 @@ void protect_init() {
 
     // Load the GDT into the CPU by passing the address of the GDT Pointer structure
     protect_flush((uint32_t)&protect_GDTPointer);
-}
\ No newline at end of file
+    // Load the kernel task register, the CPU saves interrupted state here on task switches
+    asm volatile ("ltr %%ax" : : "a" (PROTECT_SEL_TASK));
+}
+
+/**
+ * @brief Function for set up the page fault task (runs on its own stack, so faults on unmapped stacks are resolvable)
+ * 
+ * @param entry Entry point of task
+ * @param stack Top of task stack
+ */
+void protect_setFaultTask(size_t entry, size_t stack) { protect_setTask(&protect_FaultTSS, entry, stack); }
+
+/**
+ * @brief Function for set up the double fault task (runs on its own stack, so a broken fault state still reports)
+ * 
+ * @param entry Entry point of task
+ * @param stack Top of task stack
+ */
+void protect_setDoubleTask(size_t entry, size_t stack) { protect_setTask(&protect_DoubleTSS, entry, stack); }
+
+/**
+ * @brief Function for check page fault task is running (its TSS is busy, another page fault cannot enter it)
+ * 
+ * @return Busy or not (true/false)
+ */
+bool protect_faultTaskBusy(void) { return (protect_GDTEntry[4].access & 0x02) != 0; }
+
+/**
+ * @brief Function for set address space of kernel, page fault and double fault tasks
+ * (CPU loads it on every page fault and on return, but never saves it, multitask_swi also sets it)
+ * 
+ * @param cr3 Page directory address
+ */
+void protect_setTaskCR3(size_t cr3) { protect_TaskTSS.cr3 = protect_FaultTSS.cr3 = protect_DoubleTSS.cr3 = cr3; }
\ No newline at end of file
@@ -1,17 +1,31 @@
 #include "kernel.h"
 
+#include "hw/paging.h"
+
 // Initialize lock for prevent re-initializing core file system
 bool fs_InitLock = false;
 
 // Entry vector in core file system
 fs_Entry_t** fs_EntryV;
 
+// Object cache of file system entries
+int fs_EntryCache = -1;
+
 // Random access directory entry list
 int* fs_RADirent;
 
 // Random access path buffer 
 char* fs_RAPath;
 
+// Function for check whether content pages of a file are mapped by processes (mappings keep old content)
+static bool fs_mapped(fs_Entry_t* ent) {
+    for (size_t i = 0; ent->content != NULL && i < ent->pages; ++i) {
+        uint64_t phys = paging_phys((size_t)ent->content + (i * PAGING_PAGESIZE));
+        if (phys < PAGING_IDENTLIMIT && frame_refs((void*)(size_t)phys) > 0) { return true; }   // High frames are never shared
+    }
+    return false;
+}
+
 /**
  * @brief Function for get index of specific entry in entry table
  * 
@@ -184,7 +198,7 @@ int fs_createDir(const char* path) {
     for (int i = 0; i < FS_MAX_ENTCOUNT; ++i) {
         if (fs_EntryV[i] == NULL) { index = i; break; }
     } if (index == -1) { return FS_STS_OUTOFMEMORY; }
-    void* newptr = malloc(MEMORY_BLKSIZE);
+    void* newptr = memory_cacheAlloc(fs_EntryCache);
     if (newptr == NULL) { return FS_STS_OUTOFMEMORY; }
     fs_EntryV[index] = newptr;
     fs_Entry_t* dir = (fs_Entry_t*)fs_EntryV[index];
@@ -200,6 +214,7 @@ int fs_createDir(const char* path) {
     date(&dir->atime);
     dir->perm = 0777;
     dir->type = FS_TYPE_DIR;
+    dir->content = NULL; dir->pages = 0;
     return FS_STS_SUCCESS;
 }
 
@@ -221,7 +236,10 @@ char* fs_readFile(const char* path) {
                 if (fs_EntryV[i]->ftype == FS_TYPE_MOUNTED) {
                     extern void** mountmgr_MountV; if (!mountmgr_MountV) { return NULL; }
                     return (char*)mountmgr_MountV[fs_EntryV[i]->mountslot];
-                } return (char*)((char*)fs_EntryV[i] + (MEMORY_BLKSIZE));
+                } else if (fs_EntryV[i]->ftype == FS_TYPE_PSEUDO) {
+                    ent->size = ent->generator ? ent->generator(ent->content, FS_PSEUDOSIZE) : 0;
+                    return ent->content;
+                } static char empty[1]; return ent->content ? ent->content : empty;
             } break;
         }
     } return NULL;
@@ -256,10 +274,19 @@ int fs_writeFile(const char* path, size_t size, char* buf) {
         fs_Entry_t* ent = (fs_Entry_t*)fs_EntryV[i];
         if (ent->name[0] != '\0' && ent->name[0] != '\0' && compare(ent->name, path) == 0) {
             if (ent->type == FS_TYPE_DIR) { return FS_STS_NOTFILE; }
-            void* newptr = realloc(fs_EntryV[i], size + MEMORY_BLKSIZE);
-            if (newptr == NULL) { return FS_STS_OUTOFMEMORY; } fs_EntryV[i] = newptr;
-            ncopy((char*)fs_EntryV[i] + MEMORY_BLKSIZE, buf, size);
-            ent = (fs_Entry_t*)fs_EntryV[i];
+            if (ent->ftype == FS_TYPE_PSEUDO) { return FS_STS_PERMDENIED; }
+            // Content pages are dropped on truncation, replaced only when new content doesn't fit or pages are mapped
+            size_t pages = (size + MEMORY_BLKSIZE - 1) / MEMORY_BLKSIZE;
+            if (pages == 0) {
+                vfree(ent->content);
+                ent->content = NULL; ent->pages = 0;
+            } else if (pages > ent->pages || fs_mapped(ent)) {
+                char* content = (char*)vmalloc(size);
+                if (content == NULL) { return FS_STS_OUTOFMEMORY; }
+                ncopy(content, buf, size);
+                vfree(ent->content);
+                ent->content = content; ent->pages = pages;
+            } else { ncopy(ent->content, buf, size); }
             ent->size = size; date(&ent->mtime); date(&ent->atime);
             return FS_STS_SUCCESS;
         }
@@ -293,10 +320,16 @@ int fs_writeFile(const char* path, size_t size, char* buf) {
     }
     for (int i = 0; i < FS_MAX_ENTCOUNT; ++i) {
         if (fs_EntryV[i] == NULL) {
-            void* newptr = malloc(MEMORY_BLKSIZE + size);
-            if (newptr == NULL) { return FS_STS_OUTOFMEMORY; }
+            size_t pages = (size + MEMORY_BLKSIZE - 1) / MEMORY_BLKSIZE;
+            char* content = NULL; if (pages > 0) {
+                content = (char*)vmalloc(size);
+                if (content == NULL) { return FS_STS_OUTOFMEMORY; }
+            }
+            void* newptr = memory_cacheAlloc(fs_EntryCache);
+            if (newptr == NULL) { vfree(content); return FS_STS_OUTOFMEMORY; }
             fs_EntryV[i] = newptr;
             fs_Entry_t* ent = (fs_Entry_t*)fs_EntryV[i];
+            ent->content = content; ent->pages = pages;
             copy(ent->name, path);
             int user = 0;
             if (user == -1) { ent->user = 0; }
@@ -311,12 +344,32 @@ int fs_writeFile(const char* path, size_t size, char* buf) {
             ent->perm = 0777;
             ent->type = FS_TYPE_FILE;
             ent->ftype = FS_TYPE_FILE;
-            ncopy((char*)fs_EntryV[i] + MEMORY_BLKSIZE, buf, size);
+            ncopy(ent->content, buf, size);
             return FS_STS_SUCCESS;
         }
     } return FS_STS_OUTOFMEMORY;
 }
 
+/**
+ * @brief Function for create a pseudo file (content generated on every read)
+ * 
+ * @param path Path of file
+ * @param generator Content generator of file
+ * 
+ * @return Status code
+ */
+int fs_createPseudo(const char* path, size_t (*generator)(char* buf, size_t len)) {
+    if (!fs_InitLock) { return FS_STS_NOTINIT; }
+    if (generator == NULL) { return FS_STS_FAILURE; }
+    if (fs_stat(path) != NULL) { return FS_STS_ALREADYEXISTS; }
+    static char empty[FS_PSEUDOSIZE];
+    int status = fs_writeFile(path, FS_PSEUDOSIZE, empty);
+    if (status != FS_STS_SUCCESS) { return status; }
+    fs_Entry_t* ent = fs_stat(path); if (ent == NULL) { return FS_STS_FAILURE; }
+    ent->ftype = FS_TYPE_PSEUDO; ent->generator = generator; ent->size = 0;
+    ent->perm = 0444; return FS_STS_SUCCESS;
+}
+
 /**
  * @brief Function for remove a entry
  * 
@@ -349,7 +402,8 @@ int fs_remove(const char* path) {
                         length(ent2->name) > pathlen
                     ) { return FS_STS_DIRNOTEMPTY; }
                 }
-            } free(fs_EntryV[i]); fs_EntryV[i] = NULL; return FS_STS_SUCCESS;
+            } vfree(ent->content);
+            memory_cacheFree(fs_EntryCache, fs_EntryV[i]); fs_EntryV[i] = NULL; return FS_STS_SUCCESS;
         }
     } return FS_STS_ENTRYNOTFOUND;
 }
@@ -369,7 +423,8 @@ int fs_bulkRemove(const char* path) {
         if (fs_EntryV[i] == NULL) { continue; }
         fs_Entry_t* ent = (fs_Entry_t*)fs_EntryV[i];
         if (ent->name[0] != '\0' && ent->name[0] != '\0' && ncompare(ent->name, path, length(path)) == 0) {
-            free(fs_EntryV[i]); fs_EntryV[i] = NULL;
+            vfree(ent->content);
+            memory_cacheFree(fs_EntryCache, fs_EntryV[i]); fs_EntryV[i] = NULL;
         }
     } return FS_STS_SUCCESS;
 }
@@ -383,7 +438,9 @@ int corefs_init() {
     if (fs_InitLock) { return FS_STS_FAILURE; }
     fs_EntryV = (fs_Entry_t**)calloc(FS_MAX_ENTCOUNT, sizeof(fs_Entry_t*));
     if (fs_EntryV == NULL) { PANIC("Out of memory"); }
-    fs_EntryV[FS_ROOTDIR] = (fs_Entry_t*)malloc(sizeof(fs_Entry_t));
+    fs_EntryCache = memory_cacheCreate("fsent", sizeof(fs_Entry_t));
+    if (fs_EntryCache == -1) { PANIC("Can't create file system entry cache"); }
+    fs_EntryV[FS_ROOTDIR] = (fs_Entry_t*)memory_cacheAlloc(fs_EntryCache);
     if (fs_EntryV[FS_ROOTDIR] == NULL) { PANIC("Out of memory"); }
     fs_RADirent = (int*)malloc(FS_MAX_ENTCOUNT * sizeof(int));
     if (fs_RADirent == NULL) { PANIC("Out of memory"); }
@@ -393,6 +450,7 @@ int corefs_init() {
     copy(rootdir->name, "/");
     rootdir->user = 0;
     rootdir->group = 0;
+    rootdir->content = NULL; rootdir->pages = 0;
     date(&rootdir->ctime);
     date(&rootdir->mtime);
     date(&rootdir->atime);
@@ -1,10 +1,15 @@
 #include "kernel.h"
 
+#include "hw/paging.h"
+
 // * Constants
 
 // Limit of active file descriptors
 #define IOCALL_MAXFD 64
 
+// Limit of file mappings (all processes)
+#define IOCALL_MAPLIMIT 128
+
 // * Imports
 
 // Imported file system entry table from ramfs
@@ -20,11 +25,21 @@ typedef struct {
     bool op;        // Operation status
 } iocall_FileDesc_t;
 
+// Structure of file mapping
+typedef struct {
+    size_t space;   // Address space of mapping (0 if slot free)
+    size_t virt;    // Base of mapping
+    size_t size;    // Size of mapping (page aligned)
+} iocall_Map_t;
+
 // * Variables
 
 // File descriptor table
 iocall_FileDesc_t iocall_FileDesc[IOCALL_MAXFD];
 
+// File mapping table (munmap only takes mappings recorded here)
+iocall_Map_t iocall_MapV[IOCALL_MAPLIMIT];
+
 // I/O system calls initialize state
 bool iocall_Initialized = false;
 
@@ -86,16 +101,16 @@ size_t read(int fd, void* buf, size_t count) {
     //     return ptr;
     // } else
     if (fd >= TYPEFD && fd < TYPEFD + IOCALL_MAXFD) {
-        int fdesc = TYPEFD - fd; if (iocall_FileDesc[fdesc].entry == 0) { return -1; }
+        int fdesc = fd - TYPEFD; if (iocall_FileDesc[fdesc].entry == 0) { return -1; }
         if (!iocall_ForceAccess) {
             if (!(iocall_FileDesc[fdesc].flags & O_RDONLY) && !(iocall_FileDesc[fdesc].flags & O_RDWR)) { return -1; }
         }
         if (fs_EntryV[iocall_FileDesc[fdesc].entry] == NULL) { return -1; }
         fs_Entry_t* ent = (fs_Entry_t*)fs_EntryV[iocall_FileDesc[fdesc].entry];
         if (ent->type != FS_TYPE_FILE) { return -1; } char* str = (char*)buf;
-        if (ent->ftype == FS_TYPE_FILE) {
-            if (iocall_FileDesc[fdesc].ptr >= ent->size) { return 0; }
+        if (ent->ftype == FS_TYPE_FILE || ent->ftype == FS_TYPE_PSEUDO) {
             char* data = fs_readFile(ent->name); if (data == NULL) { return -1; }
+            if (iocall_FileDesc[fdesc].ptr >= ent->size) { return 0; }
             size_t remain = ent->size - iocall_FileDesc[fdesc].ptr;
             size_t limit = 0; if (count > remain) { limit = remain; } else { limit = count; }
             for (size_t i = 0; i < limit; ++i) {
@@ -179,7 +194,7 @@ size_t write(int fd, void* buf, size_t count) {
 int open(char* path, int flags) {
     if (!iocall_Initialized) { for (int i = 0; i < IOCALL_MAXFD; ++i) {
         iocall_FileDesc[i].entry = 0; iocall_FileDesc[i].flags = 0;
-        iocall_FileDesc[i].ptr = 0; iocall_FileDesc[i].op = false; } }
+        iocall_FileDesc[i].ptr = 0; iocall_FileDesc[i].op = false; } iocall_Initialized = true; }
     bool created = false; int index = fs_index(path); if (index == FS_STS_ENTRYNOTFOUND) {
         if (flags & O_CREAT) {
             if (!iocall_ForceAccess) {
@@ -225,10 +240,118 @@ int open(char* path, int flags) {
  */
 int close(int fd) {
     if (fd < TYPEFD || fd >= TYPEFD + IOCALL_MAXFD ||
-        iocall_FileDesc[fd].entry == 0 ||
-        iocall_FileDesc[fd].op == true) { return -1; }
-    iocall_FileDesc[fd].entry = 0;
-    iocall_FileDesc[fd].flags = 0;
-    iocall_FileDesc[fd].ptr = 0;
+        iocall_FileDesc[fd - TYPEFD].entry == 0 ||
+        iocall_FileDesc[fd - TYPEFD].op == true) { return -1; }
+    iocall_FileDesc[fd - TYPEFD].entry = 0;
+    iocall_FileDesc[fd - TYPEFD].flags = 0;
+    iocall_FileDesc[fd - TYPEFD].ptr = 0;
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief System call for map a file into address space of caller without copying
+ * (mounted files are shared read-only, regular files are private copy-on-write, pages of mounted files that
+ * aren't page aligned or hold other archive data are private copies of file bytes)
+ * 
+ * @param addr Address hint (ignored, mappings are placed in file mapping window)
+ * @param length Length of mapping
+ * @param prot Protection flags (PROT_READ, PROT_WRITE)
+ * @param fd File descriptor
+ * @param offset Offset in file (page aligned)
+ * 
+ * @return Address of mapping (If not available, returns null)
+ */
+void* mmap(void* addr, size_t length, int prot, int fd, size_t offset) {
+    (void)addr;
+    if (fd < TYPEFD || fd >= TYPEFD + IOCALL_MAXFD || length == 0 || (offset & (PAGING_PAGESIZE - 1))) { return NULL; }
+    iocall_FileDesc_t* desc = &iocall_FileDesc[fd - TYPEFD];
+    if (desc->entry == 0 || fs_EntryV[desc->entry] == NULL) { return NULL; }
+    if (!iocall_ForceAccess) {
+        if (!(desc->flags & O_RDONLY) && !(desc->flags & O_RDWR)) { return NULL; }
+        if ((prot & PROT_WRITE) && !(desc->flags & O_RDWR)) { return NULL; }
+    }
+    fs_Entry_t* ent = fs_EntryV[desc->entry];
+    bool mounted = (ent->ftype == FS_TYPE_MOUNTED);
+    if (ent->type != FS_TYPE_FILE || (!mounted && ent->ftype != FS_TYPE_FILE)) { return NULL; }
+    if (mounted && (prot & PROT_WRITE)) { return NULL; }       // Archive data is read-only
+    if (offset >= ent->size) { return NULL; }
+    if (length > ent->size - offset) { length = ent->size - offset; }
+    char* data = fs_readFile(ent->name); if (data == NULL) { return NULL; }
+    iocall_Map_t* map = NULL; for (int i = 0; i < IOCALL_MAPLIMIT; ++i) {
+        if (iocall_MapV[i].space == 0) { map = &iocall_MapV[i]; break; }
+    } if (map == NULL) { return NULL; }
+    size_t start = (size_t)data + offset, size = ALIGN(length, PAGING_PAGESIZE), space = paging_current();
+    size_t virt = paging_findRange(space, size); if (virt == 0) { return NULL; }
+    uint32_t flags = PAGING_FLAG_USER | (mounted ? PAGING_FLAG_SHARED : ((prot & PROT_WRITE) ? PAGING_FLAG_COW : 0));
+    bool aligned = !(start & (PAGING_PAGESIZE - 1));
+    for (size_t i = 0; i < size; i += PAGING_PAGESIZE) {
+        size_t part = (length - i < PAGING_PAGESIZE) ? length - i : PAGING_PAGESIZE;
+        uint64_t phys = 0; uint32_t pageflags = flags;
+        // Archive data is only 512-byte aligned, its pages are shared only if they hold nothing but file data
+        if (aligned && (!mounted || part == PAGING_PAGESIZE)) {
+            phys = paging_phys(start + i) & ~(uint64_t)(PAGING_PAGESIZE - 1);
+            if (!mounted && (phys >= PAGING_IDENTLIMIT || !frame_share((void*)(size_t)phys))) { phys = 0; }
+        }
+        if (phys == 0) {
+            // Take a private copy of file bytes (rest of page stays clear)
+            void* copy = frame_allocZero(); if (copy == NULL) { paging_unmapRange(space, virt, i); return NULL; }
+            ncopy(copy, (void*)(start + i), part); phys = (size_t)copy;
+            pageflags = PAGING_FLAG_USER | ((prot & PROT_WRITE) ? PAGING_FLAG_WRITE : 0);
+        }
+        if (!paging_mapPage(space, virt + i, phys, pageflags)) {
+            if (!(pageflags & PAGING_FLAG_SHARED)) { frame_free((void*)(size_t)phys); }
+            paging_unmapRange(space, virt, i); return NULL;
+        }
+    } map->space = space; map->virt = virt; map->size = size;
+    return (void*)virt;
+}
+
+/**
+ * @brief System call for unmap a mapping of mmap (only whole mappings, a whole shm_map mapping is unmapped by shm_unmap)
+ * 
+ * @param addr Address of mapping
+ * @param length Length of mapping
+ * 
+ * @return Operation status (-1 means failure)
+ */
+int munmap(void* addr, size_t length) {
+    size_t base = (size_t)addr & ~(PAGING_PAGESIZE - 1);
+    if (base < PAGING_MMAPBASE || base >= PAGING_USERSTACK || length == 0 ||
+        length > PAGING_USERSTACK - (size_t)addr) { return -1; }
+    // Shared memory mappings go only as a whole, through their records
+    int shm = shm_release(addr, length); if (shm != 0) { return (shm == 1) ? 0 : -1; }
+    size_t space = paging_current(), size = ALIGN(((size_t)addr - base) + length, PAGING_PAGESIZE);
+    for (int i = 0; i < IOCALL_MAPLIMIT; ++i) {
+        iocall_Map_t* m = &iocall_MapV[i];
+        if (m->space != space || m->virt != (size_t)addr || m->size != size) { continue; }
+        paging_unmapRange(space, m->virt, m->size); m->space = 0; return 0;
+    } return -1;
+}
+
+/**
+ * @brief Function for drop file mapping records of an address space (used when a process ends)
+ * 
+ * @param space Address space
+ */
+void iocall_detach(size_t space) {
+    for (int i = 0; i < IOCALL_MAPLIMIT; ++i) {
+        if (space != 0 && iocall_MapV[i].space == space) { iocall_MapV[i].space = 0; }
+    }
+}
+
+/**
+ * @brief Function for record file mappings of a cloned address space (page entries are copied by clone)
+ * 
+ * @param space Source address space
+ * @param clone Cloned address space
+ * 
+ * @return Recorded or not (true/false)
+ */
+bool iocall_clone(size_t space, size_t clone) {
+    for (int i = 0; i < IOCALL_MAPLIMIT; ++i) {
+        if (space == 0 || iocall_MapV[i].space != space) { continue; }
+        int slot = -1; for (int j = 0; j < IOCALL_MAPLIMIT; ++j) { if (iocall_MapV[j].space == 0) { slot = j; break; } }
+        if (slot == -1) { iocall_detach(clone); return false; }
+        iocall_MapV[slot].space = clone; iocall_MapV[slot].virt = iocall_MapV[i].virt; iocall_MapV[slot].size = iocall_MapV[i].size;
+    } return true;
+}
@@ -5,6 +5,7 @@
 #include "hw/port.h"
 #include "hw/protect.h"
 #include "hw/interrupts.h"
+#include "hw/paging.h"
 #include "hw/acpi.h"
 #include "hw/devbus.h"
 #include "hw/i8042.h"
@@ -14,6 +15,10 @@
 #include "drv/keyboard.h"
 #include "drv/mouse.h"
 
+// * Constants
+
+#define KERNEL_PREZERO      16          // Frame count cleared ahead by idle task on each turn
+
 // * Variables and tables
 
 // Physical size of the kernel in memory
@@ -23,14 +28,17 @@ size_t kernel_PhysicalSize;
 size_t kernel_OSModuleSize;
 
 // Memory size of the machine
-size_t kernel_MemorySize;
+uint64_t kernel_MemorySize;
 
 // CPU information table
 kernel_CPUInfo_t kernel_CPUInfo;
 
+// Linear framebuffer given by bootloader (null if text mode)
+void* kernel_Framebuffer;
+
 void test(void) {
     printf("Merhaba, dunya!\n");
-    // i386-elf-gcc -m32 -nostdlib -Ttext=0x4000000 -static -o test.elf test.c
+    // i386-elf-gcc -m32 -nostdlib -Ttext=0x40000000 -static -o test.elf test.c
     // INFO("Program starting...");
     // program_exec("/system/test.elf");
     exit();
@@ -77,8 +85,6 @@ void kernel_init(multiboot_info_t* boot_info, multiboot_uint32_t boot_magic) {
     // * Detect hardware and identify
         // Calculate kernel size
             kernel_PhysicalSize = (size_t)&kernel_Limit - (size_t)&kernel_Base;
-        // Get memory size from bootloader
-            kernel_MemorySize = (boot_info->mem_lower * 1024) + (boot_info->mem_upper * 1024);
         // Get information about CPU
         {   uint32_t eax, ebx, ecx, edx;
             // Vendor string (EAX=0)
@@ -98,16 +104,25 @@ void kernel_init(multiboot_info_t* boot_info, multiboot_uint32_t boot_magic) {
             }
             ncopy(kernel_CPUInfo.brand, brand, 48);
             kernel_CPUInfo.brand[48] = '\0';
-            // Basic features (EAX=1)
-            utils_cpuid(1, 0, &eax, &ebx, &ecx, &edx);
-            // Flags
-            kernel_CPUInfo.has_tsc = (edx >> 8) & 1;    // TSC bit in EDX
+            // Feature bitmap, flags are kept for information table
+            kernel_CPUInfo.features = utils_cpuFeatures();
+#ifdef UTILS_NTMEM
+            kernel_CPUInfo.features |= KERNEL_FEAT_NTMEM;
+#endif
+            kernel_CPUInfo.has_tsc = KERNEL_HAS(KERNEL_FEAT_TSC);
             if (!kernel_CPUInfo.has_tsc) { WARN("TSC not supported"); }
-            kernel_CPUInfo.has_sse = (edx >> 25) & 1;   // SSE bit in EDX
-            kernel_CPUInfo.has_avx = (ecx >> 28) & 1;   // AVX bit in ECX
-            kernel_CPUInfo.has_vtx = (ecx >> 5) & 1;    // VMX bit in ECX (Intel VT-x)
-            kernel_CPUInfo.has_aes = (ecx >> 25) & 1;   // AES bit in ECX
-            // Number of logical processors (threads) (EBX bits 23:16)
+            kernel_CPUInfo.has_sse = KERNEL_HAS(KERNEL_FEAT_SSE);
+            kernel_CPUInfo.has_avx = KERNEL_HAS(KERNEL_FEAT_AVX);
+            kernel_CPUInfo.has_vtx = KERNEL_HAS(KERNEL_FEAT_VTX);
+            kernel_CPUInfo.has_aes = KERNEL_HAS(KERNEL_FEAT_AES);
+            kernel_CPUInfo.has_pse = KERNEL_HAS(KERNEL_FEAT_PSE);
+            kernel_CPUInfo.has_pge = KERNEL_HAS(KERNEL_FEAT_PGE);
+            kernel_CPUInfo.has_pat = KERNEL_HAS(KERNEL_FEAT_PAT);
+            kernel_CPUInfo.has_pae = KERNEL_HAS(KERNEL_FEAT_PAE);
+            kernel_CPUInfo.has_x64 = KERNEL_HAS(KERNEL_FEAT_X64);
+            utils_patch(kernel_CPUInfo.features);   // Select best variants of primitives (before module is loaded)
+            // Number of logical processors (threads) (EAX=1, EBX bits 23:16)
+            utils_cpuid(1, 0, &eax, &ebx, &ecx, &edx);
             kernel_CPUInfo.threads = (ebx >> 16) & 0xff;
             // Number of cores (EAX=4, ECX=0)
             utils_cpuid(4, 0, &eax, &ebx, &ecx, &edx);
@@ -115,13 +130,8 @@ void kernel_init(multiboot_info_t* boot_info, multiboot_uint32_t boot_magic) {
             if (kernel_CPUInfo.cores == 0) { kernel_CPUInfo.cores = 1; }    // Fallback
             // If threads is zero, use core count
             if (kernel_CPUInfo.threads == 0) { kernel_CPUInfo.threads = kernel_CPUInfo.cores; }
-            // CPU Architecture (EAX=0x80000001)
-            utils_cpuid(0x80000001, 0, &eax, &ebx, &ecx, &edx);
-            // ECX bit 29 - LM (Long Mode)
-            kernel_CPUInfo.has_x64 = (edx & (1 << 29)) != 0;
-            // TSC stability (EAX=0x80000007)
-            utils_cpuid(0x80000007, 0, &eax, &ebx, &ecx, &edx);
-            if (kernel_CPUInfo.has_tsc && ((edx >> 8) & 1)) {   // Calculate first frequency if TSC stable
+            // TSC stability
+            if (KERNEL_HAS(KERNEL_FEAT_TSC | KERNEL_FEAT_TSCINV)) { // Calculate first frequency if TSC stable
                 sleep(1); uint64_t tsc1 = utils_rdtsc();        // Get TSC value after 1 second later
                 sleep(1); uint64_t tsc2 = utils_rdtsc();        // Get TSC value after 2 seconds later
                 kernel_CPUInfo.frequency = tsc2 - tsc1;         // Calculate frequency
@@ -129,17 +139,39 @@ void kernel_init(multiboot_info_t* boot_info, multiboot_uint32_t boot_magic) {
             } else if (kernel_CPUInfo.has_tsc) { WARN("TSC not stable"); }
         }
     
-    // * Find the kernel's memory field
-    size_t fieldSize = 0; {         // Variable for get available field size
+    // * Find the kernel's memory field and other available fields
+    size_t fieldSize = 0;           // Variable for get available field size
+    size_t zoneBase[MEMORY_ZONELIMIT - 1], zoneSize[MEMORY_ZONELIMIT - 1], zoneCount = 0;
+    uint64_t highBase[MEMORY_HIGHLIMIT], highSize[MEMORY_HIGHLIMIT]; size_t highCount = 0; {
         // Check for memory fields
+        kernel_MemorySize = 0;
         for (size_t i = 0; i < boot_info->mmap_length; i += sizeof(multiboot_memory_map_t)) {
             // Get memory field from bootloader
             multiboot_memory_map_t* mmmt = (multiboot_memory_map_t*) (boot_info->mmap_addr + i);
+            // Skip reserved, ACPI and defective fields
+            if (mmmt->type != MULTIBOOT_MEMORY_AVAILABLE) { continue; }
+            kernel_MemorySize += mmmt->len;
+            // Keep part above identity mapped kernel space as high memory (up to physical address limit of paging)
+            {   uint64_t start = mmmt->addr, end = mmmt->addr + mmmt->len;
+                if (start < PAGING_IDENTLIMIT) { start = PAGING_IDENTLIMIT; }
+                if (end > PAGING_PHYSLIMIT) { end = PAGING_PHYSLIMIT; }
+                if (start < end && highCount < MEMORY_HIGHLIMIT)
+                    { highBase[highCount] = start; highSize[highCount] = end - start; ++highCount; }
+                else if (start < end) { WARN("Too many high memory fields, ignoring field at 0x%x", (size_t)start); }
+            }
             // Check is kernel field or not
-            if(mmmt->type == MULTIBOOT_MEMORY_AVAILABLE) {              // Check this field available
-                if (mmmt->addr == (size_t)&kernel_Base)                 // If kernel field is here
-                    { fieldSize = (size_t)mmmt->len; }                  // Use this field
+            if (mmmt->addr == (size_t)&kernel_Base) {                   // If kernel field is here
+                uint64_t end = mmmt->addr + mmmt->len;                  // Use this field in kernel space
+                fieldSize = (size_t)(((end > PAGING_IDENTLIMIT) ? PAGING_IDENTLIMIT : end) - mmmt->addr); continue;
             }
+            // Clip field to identity mapped kernel space above low memory (BIOS data, EBDA and boot structures)
+            uint64_t start = mmmt->addr, end = mmmt->addr + mmmt->len;
+            if (start < 0x100000) { start = 0x100000; }
+            if (end > PAGING_IDENTLIMIT) { end = PAGING_IDENTLIMIT; }
+            if (start >= end) { continue; }
+            // Keep field for adding as a zone after memory manager initialized
+            if (zoneCount >= MEMORY_ZONELIMIT - 1) { WARN("Too many memory fields, ignoring the rest"); break; }
+            zoneBase[zoneCount] = (size_t)start; zoneSize[zoneCount] = (size_t)(end - start); ++zoneCount;
         } if (!fieldSize) { PANIC("Kernel field not found"); }          // If not found, halt machine
     }
 
@@ -155,10 +187,10 @@ void kernel_init(multiboot_info_t* boot_info, multiboot_uint32_t boot_magic) {
             if ((fieldSize - kernel_PhysicalSize) < kernel_OSModuleSize)
                 { PANIC("Operating system module too large"); }     // Generate panic if the module cannot fit
             INFO("Loading OS module: %s", (char*)mod->cmdline);         // Print loaded operating system module
-            uint32_t hash1 = fnv1ahash((void*)mod->mod_start, kernel_OSModuleSize); // Hash the module
-            ncopy(&kernel_Limit, (void*)mod->mod_start, kernel_OSModuleSize);   // Load the module next to the kernel
-            uint32_t hash2 = fnv1ahash(&kernel_Limit, kernel_OSModuleSize);         // Hast the loaded module
-            if (hash1 != hash2) { PANIC("Failed to load the operating system module"); } // Generate panic if different
+            // Load the module next to the kernel and checksum it in same pass
+            uint32_t sum1 = ncopysum(&kernel_Limit, (void*)mod->mod_start, kernel_OSModuleSize);
+            uint32_t sum2 = crc32c((void*)&kernel_Limit, kernel_OSModuleSize, 0);  // Checksum the loaded module
+            if (sum1 != sum2) { PANIC("Failed to load the operating system module"); }  // Generate panic if different
             // Module loaded successfully if no difference
             else { INFO("OS module loaded successfully (%s)", unit(kernel_OSModuleSize)); }
         } else { WARN("No operating system module found"); }    // Generate panic if no module loaded
@@ -167,6 +199,20 @@ void kernel_init(multiboot_info_t* boot_info, multiboot_uint32_t boot_magic) {
         protect_init();                                                         // Initialize Protected Mode
         interrupts_init();                                                      // Initialize Interrupt Manager
         memory_init(fieldSize - (kernel_PhysicalSize + kernel_OSModuleSize));   // Initialize Memory Manager
+        for (size_t i = 0; i < zoneCount; ++i) {                                // Add other memory fields
+            if (memory_addZone(zoneBase[i], zoneSize[i]) == -1)
+                { WARN("Unable to use memory field at 0x%x (%s)", zoneBase[i], unit(zoneSize[i])); }
+        }
+        for (size_t i = 0; i < highCount; ++i) {                                // Add high memory fields
+            if (memory_addHigh(highBase[i], highSize[i]) == -1)
+                { WARN("Unable to use high memory field (%d MB)", (size_t)(highSize[i] >> 20)); }
+        }
+        paging_init();                                                          // Initialize Paging
+        if ((boot_info->flags & MULTIBOOT_INFO_FRAMEBUFFER_INFO) &&             // Map linear framebuffer as write-combining
+            boot_info->framebuffer_type == MULTIBOOT_FRAMEBUFFER_TYPE_RGB && boot_info->framebuffer_addr < 0x100000000ULL) {
+            kernel_Framebuffer = paging_mapIO((size_t)boot_info->framebuffer_addr,
+                boot_info->framebuffer_pitch * boot_info->framebuffer_height, PAGING_CACHE_WC);
+        }
         corefs_init();                                                          // Initialize Core File System
         multitask_init();                                                       // Initialize Multitasking
         mountmgr_init();                                                        // Initialize Mount Manager
@@ -179,7 +225,7 @@ void kernel_init(multiboot_info_t* boot_info, multiboot_uint32_t boot_magic) {
     if (false) {
         putchar('\n');
         printf("Kernel size: %s\n", unit(kernel_PhysicalSize));         // Print kernel size
-        printf("Memory size: %s\n", unit(kernel_MemorySize));           // Print physical memory size
+        printf("Memory size: %d MB\n", (size_t)(kernel_MemorySize >> 20)); // Print physical memory size
         printf("Field size: %s\n", unit(fieldSize));                    // Print kernel field size
         printf("Free memory: %s\n", unit(mavail()));                    // Print free memory size
         { date_t current; date(&current);
@@ -300,9 +346,11 @@ void kernel_main(void) {
     // * Mount operating system module to core file system
     if (kernel_OSModuleSize) {
         INFO("Mounting OS module at root directory...");
+        memory_profTag("tarfs");
         if (tarfs_mount("/", &kernel_Limit, kernel_OSModuleSize) == -1)
             { PANIC("Operating system module mounting failed"); }
         else { INFO("OS module mounted successfully"); }
+        memory_profTag(NULL);
     }
 
     // extern unsigned char _binary_test_disk_img_start[]; extern unsigned char _binary_test_disk_img_end[];
@@ -356,6 +404,12 @@ void kernel_main(void) {
         dev = fs_stat("/dev/mouse"); if (!dev)
             { PANIC("Unable to get device file '/dev/mouse'"); }
         dev->ftype = FS_TYPE_CHARDEV; dev->devperm = O_RDONLY;
+        // /dev/meminfo
+        if (fs_createPseudo("/dev/meminfo", memory_info) != FS_STS_SUCCESS)
+            { PANIC("Unable to create pseudo file '/dev/meminfo'"); }
+        // /dev/procinfo
+        if (fs_createPseudo("/dev/procinfo", multitask_info) != FS_STS_SUCCESS)
+            { PANIC("Unable to create pseudo file '/dev/procinfo'"); }
     }
 
     if (true) {
@@ -363,14 +417,16 @@ void kernel_main(void) {
         if (spawn("kernel_idle", kernel_idle) == -1)
             { PANIC("Failed to start kernel idle task"); }
         exec("/system/test.elf");
+        int keyboard = open("/dev/keyboard", O_RDONLY);     // Open device files once, not in every loop
+        int mouse = open("/dev/mouse", O_RDONLY);
         while (true) {
             i8042_proc();
             char data;
-            int keyboard = open("/dev/keyboard", O_RDONLY);
-            if (read(keyboard, &data, 1) == 1)
-                { INFO("%s: 0x%x", (data & KEY_RELEASE) ? "Released" : "Pressed", (data & KEY_CODE)); }
+            if (read(keyboard, &data, 1) == 1) {
+                INFO("%s: 0x%x", (data & KEY_RELEASE) ? "Released" : "Pressed", (data & KEY_CODE));
+                if (data == KEY_F12) { memory_report(); }      // Dump allocation profile on F12
+            }
             char data2[3];
-            int mouse = open("/dev/mouse", O_RDONLY);
             if (read(mouse, data2, 3) == 3) {
                 INFO("Mouse: Stat: 0x%x, Xmox: %d, Ymov: %d", data2[0], data2[1], data2[2]);
             }
@@ -388,6 +444,7 @@ void kernel_idle(void) {
             sleep(1); uint64_t tsc2 = utils_rdtsc();
             kernel_CPUInfo.frequency = tsc2 - tsc1;
         }
+        frame_prezero(KERNEL_PREZERO);  // Clear free frames for demand-zero faults
         yield();
     }
 }
\ No newline at end of file
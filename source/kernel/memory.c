@@ -1,95 +1,584 @@
 #include "kernel.h"
 
+// * Imports
+
+// Imported serial mirroring flag from console (used by profiler report)
+extern bool console_HardSerial;
+
+// * Constants
+
+#define MEMORY_MAXORDER     20              // Highest chunk order of buddy allocator (2^20 blocks)
+#define MEMORY_NOBLOCK      ((size_t)-1)    // Null block index for free list links
+
+#define MEMORY_STATE_NONE   0               // Block is inside of a chunk or allocated run
+#define MEMORY_STATE_FREE   1               // Block is head of a free chunk
+#define MEMORY_STATE_USED   2               // Block is head of an allocated run
+#define MEMORY_STATE_SLAB   3               // Block is a slab page of an object cache
+
+#define MEMORY_SLABCLASSES  8               // Size class count of slab allocator (MEMORY_SLABMIN to MEMORY_SLABMAX)
+
+#define MEMORY_FRAMESHARE   4               // Frame pool takes 1/MEMORY_FRAMESHARE of kernel zone
+#define MEMORY_FRAMEMIN     64              // Minimum block count of frame pool
+#define MEMORY_FRAMESTACK   1024            // Slot count of recently freed frame stack
+#define MEMORY_ZEROSTACK    256             // Slot count of pre-zeroed frame stack (filled by idle task)
+
+#ifdef MEMORY_PROFILE
+#define MEMORY_PROFSITES    128             // Call site slots of allocation profiler (power of two)
+#define MEMORY_PROFRECORDS  8192            // Live allocation slots of allocation profiler (power of two)
+#define MEMORY_PROFREPORT   32              // Row limit of each section of profiler report
+#define MEMORY_PROFALLOC(blk, size) memory_profAlloc(blk, size, __builtin_return_address(0))
+#define MEMORY_PROFFREE(blk)        memory_profFree(blk)
+#else
+#define MEMORY_PROFALLOC(blk, size)
+#define MEMORY_PROFFREE(blk)
+#endif
+
 // * Types and structures
 
 // Structure of allocable memory block information
 typedef struct {
-    size_t count;
-    bool allocated;
+    size_t count;       // Block count of allocated run (only head of run)
+    size_t next;        // Next chunk in free list or slab page
+    size_t prev;        // Previous chunk in free list or slab page
+    void* objects;      // Free object list (only slab page)
+    uint8_t order;      // Order of free chunk (only head of free chunk)
+    uint8_t state;      // State of block
+    uint8_t cache;      // Owner object cache (only slab page)
 } memory_Block_t;
 
+// Structure of object cache
+typedef struct {
+    char name[16];      // Name of cache
+    size_t size;        // Object size
+    size_t capacity;    // Object count per slab page
+    size_t partial;     // First slab page which has free objects
+    size_t pages;       // Slab page count
+    bool active;        // Cache in use
+} memory_Cache_t;
+
+// Structure of physical memory zone (one per available memory map region)
+typedef struct {
+    void* space;                        // Allocable memory space base
+    void* limit;                        // Allocable memory space limit
+    memory_Block_t* blockv;             // Memory block structure
+    size_t blockc;                      // Memory block count
+    size_t blockf;                      // Physical frame number of first block (for natural alignment of chunks)
+    size_t freev[MEMORY_MAXORDER + 1];  // Free chunk lists of each order
+    uint32_t freemask;                  // Bit mask of non-empty free chunk lists
+    bool dma;                           // Zone is the DMA pool (not used by malloc)
+} memory_Zone_t;
+
+// Structure of physical frame pool (page-granular allocations kept out of buddy allocator)
+typedef struct {
+    void* space;                        // Base of first frame
+    void* limit;                        // Limit of last frame
+    uint32_t* bitmap;                   // Frame bitmap (set bit means free frame)
+    uint16_t* refv;                     // Extra reference counts of frames (shared copy-on-write frames)
+    size_t words;                       // Word count of bitmap
+    size_t framec;                      // Frame count
+    size_t hint;                        // Bitmap word to start next single frame scan
+    uint32_t stack[MEMORY_FRAMESTACK];  // Recently freed frames (may hold stale entries, bitmap decides)
+    size_t top;                         // Slot count in use of stack
+    uint32_t zerov[MEMORY_ZEROSTACK];   // Pre-zeroed frames (allocated, waiting for frame_allocZero)
+    size_t zeroc;                       // Slot count in use of pre-zeroed frame stack
+} memory_FramePool_t;
+
+// Structure of high memory region (frames above identity mapped kernel space, reached through temporary mappings)
+typedef struct {
+    uint64_t base;      // Physical base of first frame
+    size_t framec;      // Frame count
+    uint32_t* bitmap;   // Frame bitmap (set bit means free frame)
+    size_t words;       // Word count of bitmap
+    size_t hint;        // Bitmap word to start next scan
+} memory_HighRegion_t;
+
+#ifdef MEMORY_PROFILE
+// Structure of allocation profiler call site
+typedef struct {
+    const void* site;   // Return address of caller or subsystem tag (null if slot empty)
+    size_t bytes;       // Live bytes
+    size_t count;       // Live allocation count
+    uint32_t allocs;    // Total allocation count
+    bool tag;           // Site is a subsystem tag
+} memory_ProfSite_t;
+
+// Structure of allocation profiler live allocation record
+typedef struct {
+    void* blk;          // Address of allocation (null if slot empty)
+    size_t size;        // Requested size
+    uint16_t site;      // Call site slot
+} memory_ProfRec_t;
+#endif
+
 // * Variables and tables
 
 bool memory_InitLock = false;       // Initialize lock for prevent re-initializing memory
 
-void*           memory_Space;       // Allocable memory space base
-void*           memory_Limit;       // Allocable memory space limit
+memory_Zone_t   memory_ZoneV[MEMORY_ZONELIMIT];     // Physical memory zones (first one is the kernel zone)
+size_t          memory_ZoneC;                       // Physical memory zone count
+memory_Zone_t   memory_DMAZone;                     // DMA pool (carved from kernel zone)
+memory_FramePool_t memory_Frames;                   // Frame pool (carved from kernel zone)
+memory_HighRegion_t memory_HighV[MEMORY_HIGHLIMIT]; // High memory regions
+size_t          memory_HighC;                       // High memory region count
 
-memory_Block_t* memory_BlockV;      // Memory block structure
-size_t          memory_BlockC;      // Memory block count
+memory_Cache_t  memory_CacheV[MEMORY_CACHELIMIT];   // Object caches (first ones are size classes of malloc)
 
-// * Functions
+memory_Stats_t  memory_Stats;                       // Running allocator statistics
 
-/**
- * @brief Function for allocate memory
- * 
- * @param size Size of memory block
- * 
- * @return Address of allocated memory block (If not found, returns null)
- */
-void* malloc(size_t size) {
+#ifdef MEMORY_PROFILE
+memory_ProfSite_t   memory_ProfSiteV[MEMORY_PROFSITES];     // Call sites of allocation profiler
+memory_ProfRec_t    memory_ProfRecV[MEMORY_PROFRECORDS];    // Live allocations of allocation profiler
+const char*         memory_ProfTag;                         // Current subsystem tag (null means return address)
+uint32_t            memory_ProfLost;                        // Allocations not tracked because of full tables
+#endif
+
+// * Subfunctions
+
+// Function for find the zone which owns an address (returns null if not found)
+static memory_Zone_t* memory_findZone(size_t addr) {
+    for (size_t i = 0; i < memory_ZoneC; ++i) {
+        memory_Zone_t* z = &memory_ZoneV[i];
+        if (addr >= (size_t)z->space && addr < (size_t)z->limit) { return z; }
+    } return NULL;
+}
+
+// Function for get block information of a physical frame (frame must be inside of a zone)
+static memory_Block_t* memory_frame(size_t frame) {
+    memory_Zone_t* z = memory_findZone(frame * MEMORY_BLKSIZE);
+    return &z->blockv[frame - z->blockf];
+}
+
+// Function for push a chunk into free list of its order
+static void memory_push(memory_Zone_t* z, size_t num, uint8_t order) {
+    z->blockv[num].state = MEMORY_STATE_FREE;
+    z->blockv[num].order = order;
+    z->blockv[num].prev = MEMORY_NOBLOCK;
+    z->blockv[num].next = z->freev[order];
+    if (z->freev[order] != MEMORY_NOBLOCK) { z->blockv[z->freev[order]].prev = num; }
+    z->freev[order] = num; z->freemask |= (1U << order);
+    if (z->dma) { memory_Stats.dmafree += (size_t)1 << order; } else { memory_Stats.free += (size_t)1 << order; }
+}
+
+// Function for unlink a chunk from free list of its order
+static void memory_unlink(memory_Zone_t* z, size_t num) {
+    uint8_t order = z->blockv[num].order;
+    size_t next = z->blockv[num].next, prev = z->blockv[num].prev;
+    if (prev != MEMORY_NOBLOCK) { z->blockv[prev].next = next; } else { z->freev[order] = next; }
+    if (next != MEMORY_NOBLOCK) { z->blockv[next].prev = prev; }
+    if (z->freev[order] == MEMORY_NOBLOCK) { z->freemask &= ~(1U << order); }
+    z->blockv[num].state = MEMORY_STATE_NONE;
+    if (z->dma) { memory_Stats.dmafree -= (size_t)1 << order; } else { memory_Stats.free -= (size_t)1 << order; }
+}
+
+// Function for release a chunk and coalesce it with its free buddies
+static void memory_release(memory_Zone_t* z, size_t num, uint8_t order) {
+    while (order < MEMORY_MAXORDER) {
+        size_t buddy = ((z->blockf + num) ^ ((size_t)1 << order));
+        if (buddy < z->blockf) { break; } buddy -= z->blockf;
+        if (buddy + ((size_t)1 << order) > z->blockc) { break; }
+        if (z->blockv[buddy].state != MEMORY_STATE_FREE || z->blockv[buddy].order != order) { break; }
+        memory_unlink(z, buddy); if (buddy < num) { num = buddy; } ++order;
+    } memory_push(z, num, order);
+}
+
+// Function for release a run of blocks as naturally aligned chunks
+static void memory_releaseRun(memory_Zone_t* z, size_t num, size_t count) {
+    while (count > 0) {
+        uint8_t order = 0;
+        while (order < MEMORY_MAXORDER &&
+            !((z->blockf + num) & ((size_t)1 << order)) &&
+            ((size_t)2 << order) <= count) { ++order; }
+        memory_release(z, num, order);
+        num += (size_t)1 << order; count -= (size_t)1 << order;
+    }
+}
+
+// Function for update high-water mark of used blocks
+static void memory_updatePeak(void) {
+    size_t used = memory_Stats.total - memory_Stats.free;
+    if (used > memory_Stats.peak) { memory_Stats.peak = used; }
+}
+
+// Function for take a run of blocks from free lists of a zone (returns MEMORY_NOBLOCK if not found)
+static size_t memory_take(memory_Zone_t* z, size_t count) {
+    uint8_t order = 0; while (((size_t)1 << order) < count) { ++order; }
+    if (order > MEMORY_MAXORDER) { return MEMORY_NOBLOCK; }
+    uint32_t mask = z->freemask & ~((1U << order) - 1);
+    if (mask == 0) { return MEMORY_NOBLOCK; }
+    uint8_t found = (uint8_t)__builtin_ctz(mask);
+    size_t num = z->freev[found]; memory_unlink(z, num);
+    // Split the chunk down to requested order
+    while (found > order) { --found; memory_push(z, num + ((size_t)1 << found), found); }
+    // Give back the unused tail of chunk
+    memory_releaseRun(z, num + count, ((size_t)1 << order) - count);
+    memory_updatePeak();
+    return num;
+}
+
+// Function for take a run of blocks from first zone which can satisfy it (returns null if not found)
+static memory_Zone_t* memory_takeAny(size_t count, size_t* num) {
+    for (size_t i = 0; i < memory_ZoneC; ++i) {
+        *num = memory_take(&memory_ZoneV[i], count);
+        if (*num != MEMORY_NOBLOCK) { return &memory_ZoneV[i]; }
+    } return NULL;
+}
+
+// Function for allocate an object from slab pages of a cache
+static void* memory_slabAlloc(int cache) {
+    memory_Cache_t* c = &memory_CacheV[cache];
+    size_t frame = c->partial;
+    if (frame == MEMORY_NOBLOCK) {
+        // Carve a new slab page into objects
+        size_t num; memory_Zone_t* z = memory_takeAny(1, &num);
+        if (z == NULL) { return NULL; }
+        memory_Block_t* page = &z->blockv[num];
+        frame = z->blockf + num;
+        char* base = (char*)(frame * MEMORY_BLKSIZE);
+        page->state = MEMORY_STATE_SLAB; page->cache = (uint8_t)cache;
+        page->count = 0; page->objects = NULL;
+        for (size_t i = c->capacity; i > 0; --i) {
+            void** obj = (void**)(base + ((i - 1) * c->size));
+            *obj = page->objects; page->objects = obj;
+        }
+        page->prev = MEMORY_NOBLOCK; page->next = MEMORY_NOBLOCK;
+        c->partial = frame; c->pages++; memory_Stats.slabs++;
+    }
+    memory_Block_t* page = memory_frame(frame);
+    void** obj = (void**)page->objects;
+    page->objects = *obj; page->count++;
+    if (page->objects == NULL) {    // Page is full, remove it from partial list
+        c->partial = page->next;
+        if (page->next != MEMORY_NOBLOCK) { memory_frame(page->next)->prev = MEMORY_NOBLOCK; }
+    }
+    return obj;
+}
+
+// Function for free an object back to its slab page
+static void memory_slabFree(memory_Zone_t* z, size_t num, void* obj) {
+    memory_Block_t* page = &z->blockv[num];
+    memory_Cache_t* c = &memory_CacheV[page->cache];
+    size_t frame = z->blockf + num;
+    size_t ofs = (size_t)obj - (frame * MEMORY_BLKSIZE);
+    if (ofs % c->size != 0 || ofs / c->size >= c->capacity) { return; }    // invalid free
+    memory_Stats.frees++;
+    bool full = (page->objects == NULL);
+    *(void**)obj = page->objects; page->objects = obj; page->count--;
+    if (full) {     // Page has a free object again, put it into partial list
+        page->prev = MEMORY_NOBLOCK; page->next = c->partial;
+        if (c->partial != MEMORY_NOBLOCK) { memory_frame(c->partial)->prev = frame; }
+        c->partial = frame;
+    }
+    // Give empty page back to buddy allocator if it is not the last partial page
+    if (page->count == 0 && (page->prev != MEMORY_NOBLOCK || page->next != MEMORY_NOBLOCK)) {
+        if (page->prev != MEMORY_NOBLOCK) { memory_frame(page->prev)->next = page->next; }
+        else { c->partial = page->next; }
+        if (page->next != MEMORY_NOBLOCK) { memory_frame(page->next)->prev = page->prev; }
+        page->state = MEMORY_STATE_NONE; c->pages--; memory_Stats.slabs--;
+        memory_releaseRun(z, num, 1);
+    }
+}
+
+// Function for set up an object cache in specific slot
+static void memory_cacheSetup(int cache, const char* name, size_t size) {
+    memory_Cache_t* c = &memory_CacheV[cache];
+    fill(c->name, 0, sizeof(c->name));
+    if (length(name) < (int)sizeof(c->name)) { copy(c->name, name); }
+    else { ncopy(c->name, name, sizeof(c->name) - 1); }
+    c->size = size; c->capacity = MEMORY_BLKSIZE / size;
+    c->partial = MEMORY_NOBLOCK; c->pages = 0; c->active = true;
+}
+
+// Function for set up a zone on a physical memory region (returns false if region is too small)
+static bool memory_zoneSetup(memory_Zone_t* z, size_t base, size_t size, bool dma) {
+    size_t supblkc = size / (MEMORY_BLKSIZE + sizeof(memory_Block_t));
+    supblkc -= supblkc ? 1 : 0;
+    if (supblkc == 0) { return false; }
+
+    z->space = (void*)(base + (supblkc * sizeof(memory_Block_t)));
+    z->space = (void*)(((size_t)z->space + MEMORY_BLKSIZE) & ~((size_t)MEMORY_BLKSIZE - 1));
+    z->limit = (void*)((size_t)z->space + (supblkc * MEMORY_BLKSIZE));
+
+    z->blockv = (memory_Block_t*)(base);
+    z->blockc = supblkc;
+    z->blockf = (size_t)z->space / MEMORY_BLKSIZE;
+
+    for (size_t i = 0; i < z->blockc; i++) {
+        z->blockv[i].count = 0;
+        z->blockv[i].state = MEMORY_STATE_NONE;
+    }
+
+    // Build free lists from whole space
+    for (uint8_t order = 0; order <= MEMORY_MAXORDER; ++order) { z->freev[order] = MEMORY_NOBLOCK; }
+    z->freemask = 0; z->dma = dma;
+    if (dma) { memory_Stats.dma += z->blockc; } else { memory_Stats.total += z->blockc; }
+    memory_releaseRun(z, 0, z->blockc);
+
+    return true;
+}
+
+// Function for set up frame pool on a run of blocks (bitmap and reference counts are placed in first blocks of run)
+static void memory_frameSetup(size_t base, size_t count) {
+    memory_FramePool_t* p = &memory_Frames;
+    size_t mapsize = ((count + 31) / 32) * sizeof(uint32_t);
+    size_t meta = (mapsize + (count * sizeof(uint16_t)) + MEMORY_BLKSIZE - 1) / MEMORY_BLKSIZE;
+    p->bitmap = (uint32_t*)base;
+    p->refv = (uint16_t*)(base + mapsize);
+    p->framec = count - meta;
+    p->words = (p->framec + 31) / 32;
+    p->space = (void*)(base + (meta * MEMORY_BLKSIZE));
+    p->limit = (void*)((size_t)p->space + (p->framec * MEMORY_BLKSIZE));
+    p->hint = 0; p->top = 0; p->zeroc = 0;
+    // Every frame starts free, padding bits of last word stay clear
+    fill(p->bitmap, 0xFF, p->words * sizeof(uint32_t));
+    fill(p->refv, 0, p->framec * sizeof(uint16_t));
+    if (p->framec & 31) { p->bitmap[p->words - 1] = (1U << (p->framec & 31)) - 1; }
+    memory_Stats.frames = memory_Stats.framefree = p->framec;
+}
+
+// Function for set (free) or clear (used) bits of a frame run, a word at a time
+static void memory_frameMark(size_t first, size_t count, bool release) {
+    memory_FramePool_t* p = &memory_Frames;
+    if (release) { memory_Stats.framefree += count; } else { memory_Stats.framefree -= count; }
+    while (count > 0) {
+        size_t bit = first & 31, n = 32 - bit; if (n > count) { n = count; }
+        uint32_t mask = (n == 32) ? 0xFFFFFFFF : (((1U << n) - 1) << bit);
+        if (release) { p->bitmap[first >> 5] |= mask; } else { p->bitmap[first >> 5] &= ~mask; }
+        first += n; count -= n;
+    }
+}
+
+// Function for check whether a frame run is completely used (for reject invalid frees)
+static bool memory_frameUsed(size_t first, size_t count) {
+    memory_FramePool_t* p = &memory_Frames;
+    for (size_t i = first; i < first + count; ++i) {
+        if (p->bitmap[i >> 5] & (1U << (i & 31))) { return false; }
+    } return true;
+}
+
+// Function for take a single frame from stack or bitmap (returns MEMORY_NOBLOCK if pool is full)
+static size_t memory_frameTake(void) {
+    memory_FramePool_t* p = &memory_Frames;
+    while (p->top > 0) {
+        size_t num = p->stack[--p->top];
+        if (p->bitmap[num >> 5] & (1U << (num & 31))) { memory_frameMark(num, 1, false); return num; }
+    }
+    for (size_t i = 0; i < p->words; ++i) {
+        size_t word = p->hint + i; if (word >= p->words) { word -= p->words; }
+        if (p->bitmap[word] == 0) { continue; }
+        size_t num = (word * 32) + __builtin_ctz(p->bitmap[word]);
+        p->hint = word; memory_frameMark(num, 1, false); return num;
+    } return MEMORY_NOBLOCK;
+}
+
+// Function for take a run of frames by first fit over bitmap (returns MEMORY_NOBLOCK if not found)
+static size_t memory_frameTakeRun(size_t count) {
+    memory_FramePool_t* p = &memory_Frames;
+    size_t start = 0, run = 0;
+    for (size_t word = 0; word < p->words; ++word) {
+        uint32_t bits = p->bitmap[word];
+        if (bits == 0) { run = 0; continue; }
+        if (bits == 0xFFFFFFFF) {
+            if (run == 0) { start = word * 32; }
+            run += 32; if (run >= count) { break; } continue;
+        }
+        // Mixed word, continue bit by bit
+        for (size_t bit = 0; bit < 32 && run < count; ++bit) {
+            if (bits & (1U << bit)) { if (run++ == 0) { start = (word * 32) + bit; } } else { run = 0; }
+        } if (run >= count) { break; }
+    } if (run < count) { return MEMORY_NOBLOCK; }
+    memory_frameMark(start, count, false);
+    return start;
+}
+
+#ifdef MEMORY_PROFILE
+// Function for hash an address into a profiler table slot
+static size_t memory_profHash(const void* ptr, size_t limit) {
+    return (((size_t)ptr >> 4) * 2654435761U) & (limit - 1);
+}
+
+// Function for record an allocation to profiler
+static void memory_profAlloc(void* blk, size_t size, void* caller) {
+    if (blk == NULL) { return; }
+    const void* key = memory_ProfTag ? (const void*)memory_ProfTag : caller;
+    // Find or claim call site slot
+    size_t site = memory_profHash(key, MEMORY_PROFSITES), n = 0;
+    for (; n < MEMORY_PROFSITES; ++n, site = (site + 1) & (MEMORY_PROFSITES - 1)) {
+        if (memory_ProfSiteV[site].site == key) { break; }
+        if (memory_ProfSiteV[site].site == NULL) {
+            memory_ProfSiteV[site].site = key; memory_ProfSiteV[site].tag = (memory_ProfTag != NULL); break;
+        }
+    } if (n == MEMORY_PROFSITES) { memory_ProfLost++; return; }
+    // Claim live allocation slot
+    size_t rec = memory_profHash(blk, MEMORY_PROFRECORDS);
+    for (n = 0; n < MEMORY_PROFRECORDS && memory_ProfRecV[rec].blk != NULL; ++n)
+        { rec = (rec + 1) & (MEMORY_PROFRECORDS - 1); }
+    if (n == MEMORY_PROFRECORDS) { memory_ProfLost++; return; }
+    memory_ProfRecV[rec].blk = blk; memory_ProfRecV[rec].size = size; memory_ProfRecV[rec].site = (uint16_t)site;
+    memory_ProfSiteV[site].bytes += size; memory_ProfSiteV[site].count++; memory_ProfSiteV[site].allocs++;
+}
+
+// Function for remove an allocation from profiler
+static void memory_profFree(void* blk) {
+    if (blk == NULL) { return; }
+    size_t rec = memory_profHash(blk, MEMORY_PROFRECORDS), n = 0;
+    for (; n < MEMORY_PROFRECORDS && memory_ProfRecV[rec].blk != blk; ++n) {
+        if (memory_ProfRecV[rec].blk == NULL) { return; }       // not tracked
+        rec = (rec + 1) & (MEMORY_PROFRECORDS - 1);
+    } if (n == MEMORY_PROFRECORDS) { return; }
+    memory_ProfSite_t* site = &memory_ProfSiteV[memory_ProfRecV[rec].site];
+    site->bytes -= memory_ProfRecV[rec].size; site->count--;
+    // Shift following records back to keep probe chains unbroken
+    for (size_t next = (rec + 1) & (MEMORY_PROFRECORDS - 1); memory_ProfRecV[next].blk != NULL;
+        next = (next + 1) & (MEMORY_PROFRECORDS - 1)) {
+        size_t home = memory_profHash(memory_ProfRecV[next].blk, MEMORY_PROFRECORDS);
+        if ((rec <= next) ? (rec < home && home <= next) : (rec < home || home <= next)) { continue; }
+        memory_ProfRecV[rec] = memory_ProfRecV[next]; rec = next;
+    } memory_ProfRecV[rec].blk = NULL;
+}
+#endif
+
+// Function for allocate memory from slab allocator or buddy allocator
+static void* memory_alloc(size_t size) {
     if (!memory_InitLock) { return NULL; }
     if (size == 0) { return NULL; }
 
+    // Route small requests to size classes of slab allocator
+    if (size <= MEMORY_SLABMAX) {
+        int cls = 0; for (size_t c = MEMORY_SLABMIN; c < size; c <<= 1) { ++cls; }
+        void* obj = memory_slabAlloc(cls);
+        if (obj == NULL) { memory_Stats.failures++; } else { memory_Stats.allocs++; }
+        return obj;
+    }
+
     // Calculate block count (ceil division)
     size_t count = (size + MEMORY_BLKSIZE - 1) / MEMORY_BLKSIZE;
+    if (count == 0) { memory_Stats.failures++; return NULL; }
 
-    size_t base = 0;
-    bool status = false;
+    // Take free blocks from buddy allocator of first fitting zone
+    size_t base; memory_Zone_t* z = memory_takeAny(count, &base);
+    if (z == NULL) { memory_Stats.failures++; return NULL; }
+    memory_Stats.allocs++;
 
-    // Find free region
-    for (size_t i = 0; i <= memory_BlockC - count; i++) {
-        bool ok = true;
-        for (size_t j = 0; j < count; j++) {
-            if (memory_BlockV[i + j].allocated) {
-                ok = false;
-                break;
-            }
+    // Mark run as allocated
+    z->blockv[base].state = MEMORY_STATE_USED;
+    z->blockv[base].count = count;
+
+    return (void*)((size_t)z->space + (base * MEMORY_BLKSIZE));
+}
+
+// Function for free an allocated memory block
+static void memory_free(void* blk) {
+    if (!memory_InitLock || blk == NULL) { return; }
+    memory_Zone_t* z = memory_findZone((size_t)blk);
+    if (z == NULL) { return; }
+
+    size_t num = ((size_t)blk - (size_t)z->space) / MEMORY_BLKSIZE;
+    if (z->blockv[num].state == MEMORY_STATE_SLAB) { memory_slabFree(z, num, blk); return; }
+    if (z->blockv[num].state != MEMORY_STATE_USED) { return; }     // invalid free
+    memory_Stats.frees++;
+
+    size_t count = z->blockv[num].count;
+    z->blockv[num].state = MEMORY_STATE_NONE;
+    z->blockv[num].count = 0;
+    memory_releaseRun(z, num, count);
+}
+
+// Function for reallocate memory (in place if possible)
+static void* memory_realloc(void* blk, size_t size) {
+    if (!memory_InitLock || blk == NULL) { return NULL; }
+    memory_Zone_t* z = memory_findZone((size_t)blk);
+    if (z == NULL) { return NULL; }
+    if (size == 0) { return NULL; }
+    size_t num = ((size_t)blk - (size_t)z->space) / MEMORY_BLKSIZE;
+    size_t old = 0;
+    if (z->blockv[num].state == MEMORY_STATE_SLAB) {
+        // Object still fits in its size class
+        old = memory_CacheV[z->blockv[num].cache].size;
+        if (size <= old) { return blk; }
+    } else if (z->blockv[num].state == MEMORY_STATE_USED) {
+        size_t count = z->blockv[num].count;
+        size_t newcount = (size + MEMORY_BLKSIZE - 1) / MEMORY_BLKSIZE;
+        old = count * MEMORY_BLKSIZE;
+        // Shrink in place by giving back the tail
+        if (newcount <= count) {
+            if (newcount < count) {
+                z->blockv[num].count = newcount;
+                memory_releaseRun(z, num + newcount, count - newcount);
+            } return blk;
         }
-        if (ok) {
-            base = i;
-            status = true;
-            break;
+        // Grow in place if following chunks are free
+        size_t need = newcount - count, got = 0, next = num + count;
+        while (got < need && next < z->blockc && z->blockv[next].state == MEMORY_STATE_FREE) {
+            got += (size_t)1 << z->blockv[next].order;
+            next += (size_t)1 << z->blockv[next].order;
         }
-    }
+        if (got >= need) {
+            for (size_t i = num + count; i < next;) {
+                size_t step = (size_t)1 << z->blockv[i].order;
+                memory_unlink(z, i); i += step;
+            }
+            z->blockv[num].count = newcount;
+            memory_releaseRun(z, num + newcount, got - need);
+            memory_updatePeak();
+            return blk;
+        }
+    } else { return NULL; }     // invalid reallocation
+    // Move to a new place
+    void* newblk = memory_alloc(size);
+    if (newblk == NULL) { return NULL; }
+    ncopy(newblk, blk, (size < old) ? size : old);
+    memory_free(blk);
+    return newblk;
+}
 
-    if (!status) { return NULL; }
+// Function for check whether a block is a frame of frame pool (page-sized blocks of calloc)
+static inline bool memory_isFrame(const void* blk) {
+    return (size_t)blk >= (size_t)memory_Frames.space && (size_t)blk < (size_t)memory_Frames.limit;
+}
 
-    // Mark blocks as allocated
-    for (size_t i = 0; i < count; i++) {
-        memory_BlockV[base + i].allocated = true;
-        memory_BlockV[base + i].count = 0;  // clear old info
-    }
-    memory_BlockV[base].count = count;
+// * Functions
 
-    return (void*)((size_t)memory_Space + (base * MEMORY_BLKSIZE));
+/**
+ * @brief Function for allocate memory
+ * 
+ * @param size Size of memory block
+ * 
+ * @return Address of allocated memory block (If not found, returns null)
+ */
+void* malloc(size_t size) {
+    void* blk = memory_alloc(size);
+    MEMORY_PROFALLOC(blk, size);
+    return blk;
 }
 
 /**
- * @brief Function for allocate cleared memory
+ * @brief Function for allocate cleared memory (physically contiguous, page-sized blocks are frames pre-zeroed by
+ * idle task if any, demand-zero memory is taken with vzalloc)
  */
 void* calloc(size_t nmemb, size_t size) {
     if (!memory_InitLock) { return NULL; }
+    if (size != 0 && nmemb > UINT_MAX / size) { return NULL; }
     size_t n = nmemb * size;
-    if (n > UINT_MAX) { return NULL; }
-    void* blk = malloc(n);
+    if (n > MEMORY_SLABMAX && n <= MEMORY_BLKSIZE && memory_Frames.zeroc > 0) { return frame_allocZero(); }
+    void* blk = memory_alloc(n);
     if (blk == NULL) { return NULL; }
+    MEMORY_PROFALLOC(blk, n);
     fill(blk, 0, n);
     return blk;
 }
 
 /**
- * @brief Function for reallocate memory
+ * @brief Function for reallocate memory (in place if possible)
  */
 void* realloc(void* blk, size_t size) {
-    if (!memory_InitLock || blk == NULL ||
-        (size_t)blk < (size_t)memory_Space ||
-        (size_t)blk >= (size_t)memory_Limit
-    ) { return NULL; }
-    void* newblk = malloc(size);
-    if (newblk == NULL) { return NULL; }
-    ncopy(newblk, blk, size);
-    free(blk);
+    if (memory_isFrame(blk)) {
+        // Page-sized block of calloc, move to a new block
+        void* newblk = malloc(size); if (newblk == NULL) { return NULL; }
+        ncopy(newblk, blk, (size < MEMORY_BLKSIZE) ? size : MEMORY_BLKSIZE);
+        frame_free(blk); return newblk;
+    }
+    void* newblk = memory_realloc(blk, size);
+    if (newblk != NULL) { MEMORY_PROFFREE(blk); MEMORY_PROFALLOC(newblk, size); }
     return newblk;
 }
 
@@ -97,58 +586,486 @@ void* realloc(void* blk, size_t size) {
  * @brief Function for free an allocated memory block
  */
 void free(void* blk) {
-    if (!memory_InitLock || blk == NULL ||
-        (size_t)blk < (size_t)memory_Space ||
-        (size_t)blk >= (size_t)memory_Limit
-    ) { return; }
-
-    size_t num = ((size_t)blk - (size_t)memory_Space) / MEMORY_BLKSIZE;
-    size_t count = memory_BlockV[num].count;
-
-    if (count == 0) { return; }  // invalid free
-
-    for (size_t i = 0; i < count; i++) {
-        memory_BlockV[num + i].allocated = false;
-        memory_BlockV[num + i].count = 0;
-    }
+    if (memory_isFrame(blk)) { frame_free(blk); return; }     // Page-sized block of calloc
+    MEMORY_PROFFREE(blk);
+    memory_free(blk);
 }
 
 /**
- * @brief Function for get available memory size
+ * @brief Function for get available memory size of heap zones (malloc memory only, frame pool, DMA pool and
+ * high memory are excluded, memory_stats reports them separately)
  */
 size_t mavail() {
     if (!memory_InitLock) { return 0; }
-    size_t result = 0;
-    for (size_t i = 0; i < memory_BlockC; i++) {
-        if (!memory_BlockV[i].allocated) { result += MEMORY_BLKSIZE; }
-    }
-    return result;
+    return memory_Stats.free * MEMORY_BLKSIZE;
+}
+
+/**
+ * @brief Function for get allocator statistics
+ * 
+ * @param stats Statistics structure to write
+ */
+void memory_stats(memory_Stats_t* stats) {
+    if (stats == NULL) { return; }
+    if (!memory_InitLock) { fill(stats, 0, sizeof(memory_Stats_t)); return; }
+    ncopy(stats, &memory_Stats, sizeof(memory_Stats_t));
+    stats->used = memory_Stats.total - memory_Stats.free;
+    stats->zones = memory_ZoneC;
+    stats->framezero = memory_Frames.zeroc;
+    // Largest free block is the head of highest non-empty order of all heap zones (a free extent may span more chunks)
+    uint32_t mask = 0; for (size_t i = 0; i < memory_ZoneC; ++i) { mask |= memory_ZoneV[i].freemask; }
+    stats->largestblock = mask ? ((size_t)1 << (31 - __builtin_clz(mask))) : 0;
+}
+
+/**
+ * @brief Function for write allocator statistics as text (used by /dev/meminfo)
+ * 
+ * @param buf Buffer to write
+ * @param len Length of buffer
+ * 
+ * @return Length of written text
+ */
+size_t memory_info(char* buf, size_t len) {
+    if (buf == NULL || len == 0) { return 0; }
+    memory_Stats_t st; memory_stats(&st);
+    size_t kb = MEMORY_BLKSIZE / 1024;
+    return (size_t)snprintf(buf, len,
+        "Total:\t\t%d KB\nFree:\t\t%d KB\nUsed:\t\t%d KB\nPeak:\t\t%d KB\n"
+        "Largest block:\t%d KB\nSlabs:\t\t%d KB\nZones:\t\t%d\nDMA:\t\t%d KB\nDMA free:\t%d KB\n"
+        "Frames:\t\t%d KB\nFrames free:\t%d KB\nFrames zeroed:\t%d KB\nHigh:\t\t%d KB\nHigh free:\t%d KB\n"
+        "Allocs:\t\t%d\nFrees:\t\t%d\nFailures:\t%d\n",
+        st.total * kb, st.free * kb, st.used * kb, st.peak * kb,
+        st.largestblock * kb, st.slabs * kb, st.zones, st.dma * kb, st.dmafree * kb,
+        st.frames * kb, st.framefree * kb, st.framezero * kb, st.high * kb, st.highfree * kb,
+        st.allocs, st.frees, st.failures);
 }
 
 /**
  * @brief Function for initialize memory manager
+ * 
+ * @param size Size of available memory after the kernel and operating system module (kernel zone)
  */
 void memory_init(size_t size) {
     if (memory_InitLock) { return; }
     memory_InitLock = true;
 
-    if (size > UINT_MAX) { PANIC("64-bit addressing not supported"); }
+    // Set up kernel zone next to the kernel and operating system module
+    memory_ZoneC = 0; memory_HighC = 0; fill(&memory_Stats, 0, sizeof(memory_Stats_t));
+    if (!memory_zoneSetup(&memory_ZoneV[0], (size_t)&kernel_Limit + kernel_OSModuleSize, size, false))
+        { PANIC("Not enough memory detected"); }
+    memory_ZoneC = 1;
 
-    size_t supblkc = size / (MEMORY_BLKSIZE + sizeof(memory_Block_t));
-    supblkc -= supblkc ? 1 : 0;
-    if (supblkc == 0) { PANIC("Not enough memory detected"); }
+    // Set up DMA pool on a run reserved from kernel zone
+    size_t dmacount = MEMORY_DMASIZE / MEMORY_BLKSIZE;
+    size_t dmabase = memory_take(&memory_ZoneV[0], dmacount);
+    if (dmabase == MEMORY_NOBLOCK) { WARN("Not enough memory for DMA pool"); }
+    else {
+        memory_ZoneV[0].blockv[dmabase].state = MEMORY_STATE_USED;
+        memory_ZoneV[0].blockv[dmabase].count = dmacount;
+        memory_zoneSetup(&memory_DMAZone,
+            (size_t)memory_ZoneV[0].space + (dmabase * MEMORY_BLKSIZE), MEMORY_DMASIZE, true);
+    }
+
+    // Set up frame pool on a run reserved from kernel zone (halve request until it fits)
+    size_t framecount = memory_ZoneV[0].blockc / MEMORY_FRAMESHARE, framebase = MEMORY_NOBLOCK;
+    while (framecount >= MEMORY_FRAMEMIN &&
+        (framebase = memory_take(&memory_ZoneV[0], framecount)) == MEMORY_NOBLOCK) { framecount /= 2; }
+    if (framebase == MEMORY_NOBLOCK) { WARN("Not enough memory for frame pool"); }
+    else {
+        memory_ZoneV[0].blockv[framebase].state = MEMORY_STATE_USED;
+        memory_ZoneV[0].blockv[framebase].count = framecount;
+        memory_frameSetup((size_t)memory_ZoneV[0].space + (framebase * MEMORY_BLKSIZE), framecount);
+    }
+
+    // Set up size classes of slab allocator
+    for (int i = 0; i < MEMORY_SLABCLASSES; ++i) {
+        char name[16]; snprintf(name, sizeof(name), "size-%d", MEMORY_SLABMIN << i);
+        memory_cacheSetup(i, name, MEMORY_SLABMIN << i);
+    }
+}
+
+/**
+ * @brief Function for add a physical memory region as a new zone
+ * 
+ * @param base Base address of region (region must be unused and identity mapped)
+ * @param size Size of region
+ * 
+ * @return Zone number (-1 means failure)
+ */
+int memory_addZone(size_t base, size_t size) {
+    if (!memory_InitLock || memory_ZoneC >= MEMORY_ZONELIMIT ||
+        base == 0 || size == 0 || base + size < base) { return -1; }
+    // Reject regions overlapping existing zones
+    for (size_t i = 0; i < memory_ZoneC; ++i) {
+        if (base < (size_t)memory_ZoneV[i].limit &&
+            base + size > (size_t)memory_ZoneV[i].blockv) { return -1; }
+    }
+    if (!memory_zoneSetup(&memory_ZoneV[memory_ZoneC], base, size, false)) { return -1; }
+    return (int)memory_ZoneC++;
+}
+
+/**
+ * @brief Function for add a physical memory region above identity mapped kernel space as high memory
+ * (frames are handed out one at a time for pages of vmalloc and process address spaces)
+ * 
+ * @param base Base address of region (region must be unused)
+ * @param size Size of region
+ * 
+ * @return Region number (-1 means failure)
+ */
+int memory_addHigh(uint64_t base, uint64_t size) {
+    if (!memory_InitLock || memory_HighC >= MEMORY_HIGHLIMIT || base + size < base) { return -1; }
+    uint64_t end = (base + size) & ~(uint64_t)(MEMORY_BLKSIZE - 1);
+    base = (base + MEMORY_BLKSIZE - 1) & ~(uint64_t)(MEMORY_BLKSIZE - 1);
+    if (base == 0 || end <= base) { return -1; }
+    // Reject regions overlapping existing regions
+    for (size_t i = 0; i < memory_HighC; ++i) {
+        memory_HighRegion_t* h = &memory_HighV[i];
+        if (base < h->base + ((uint64_t)h->framec * MEMORY_BLKSIZE) && end > h->base) { return -1; }
+    }
+    // Bitmap is kept in kernel zone, every frame starts free
+    memory_HighRegion_t* h = &memory_HighV[memory_HighC];
+    h->framec = (size_t)((end - base) / MEMORY_BLKSIZE);
+    h->words = (h->framec + 31) / 32;
+    h->bitmap = (uint32_t*)memory_alloc(h->words * sizeof(uint32_t));
+    if (h->bitmap == NULL) { return -1; }
+    fill(h->bitmap, 0xFF, h->words * sizeof(uint32_t));
+    if (h->framec & 31) { h->bitmap[h->words - 1] = (1U << (h->framec & 31)) - 1; }
+    h->base = base; h->hint = 0;
+    memory_Stats.high += h->framec; memory_Stats.highfree += h->framec;
+    return (int)memory_HighC++;
+}
+
+/**
+ * @brief Function for allocate a zeroed, physically contiguous buffer for DMA
+ * 
+ * @param size Size of buffer
+ * @param align Alignment of buffer (power of two, 0 means block alignment)
+ * @param boundary Address boundary which buffer must not cross (power of two, 0 means no boundary)
+ * @param phys Physical address of buffer to write (can be null)
+ * 
+ * @return Address of allocated buffer (If not available, returns null)
+ */
+void* dma_alloc(size_t size, size_t align, size_t boundary, uint64_t* phys) {
+    memory_Zone_t* z = &memory_DMAZone;
+    if (!memory_InitLock || z->blockc == 0 || size == 0) { return NULL; }
+    if ((align & (align - 1)) || (boundary & (boundary - 1))) { return NULL; }
+    // Chunks are naturally aligned, so a chunk not larger than boundary never crosses it
+    if (boundary && size > boundary) { return NULL; }
+    size_t count = (size + MEMORY_BLKSIZE - 1) / MEMORY_BLKSIZE;
+    size_t chunk = 1; while (chunk < count || chunk * MEMORY_BLKSIZE < align) { chunk <<= 1; }
+    size_t num = memory_take(z, chunk);
+    if (num == MEMORY_NOBLOCK) { memory_Stats.failures++; return NULL; }
+    memory_releaseRun(z, num + count, chunk - count);
+    z->blockv[num].state = MEMORY_STATE_USED;
+    z->blockv[num].count = count;
+    void* buf = (void*)((size_t)z->space + (num * MEMORY_BLKSIZE));
+    fill(buf, 0, count * MEMORY_BLKSIZE); MEMORY_PROFALLOC(buf, size);
+    if (phys != NULL) { *phys = (uint64_t)(size_t)buf; }   // Memory is identity mapped
+    return buf;
+}
+
+/**
+ * @brief Function for free a buffer allocated by dma_alloc
+ * 
+ * @param buf Address of buffer
+ */
+void dma_free(void* buf) {
+    memory_Zone_t* z = &memory_DMAZone;
+    if (!memory_InitLock || buf == NULL ||
+        (size_t)buf < (size_t)z->space ||
+        (size_t)buf >= (size_t)z->limit
+    ) { return; }
+    size_t num = ((size_t)buf - (size_t)z->space) / MEMORY_BLKSIZE;
+    if (z->blockv[num].state != MEMORY_STATE_USED) { return; }  // invalid free
+    MEMORY_PROFFREE(buf);
+    size_t count = z->blockv[num].count;
+    z->blockv[num].state = MEMORY_STATE_NONE;
+    z->blockv[num].count = 0;
+    memory_releaseRun(z, num, count);
+}
+
+/**
+ * @brief Function for allocate a physical page frame
+ * 
+ * @return Address of allocated frame (If not available, returns null)
+ */
+void* frame_alloc(void) {
+    if (!memory_InitLock) { return NULL; }
+    size_t num = memory_frameTake();
+    if (num == MEMORY_NOBLOCK && memory_Frames.zeroc > 0) { num = memory_Frames.zerov[--memory_Frames.zeroc]; }
+    // Fall back to buddy allocator when frame pool is exhausted
+    void* frame = (num != MEMORY_NOBLOCK) ?
+        (void*)((size_t)memory_Frames.space + (num * MEMORY_BLKSIZE)) : memory_alloc(MEMORY_BLKSIZE);
+    if (frame == NULL) { return NULL; }
+    if (num != MEMORY_NOBLOCK) { memory_Stats.allocs++; }
+    MEMORY_PROFALLOC(frame, MEMORY_BLKSIZE);
+    return frame;
+}
+
+/**
+ * @brief Function for allocate a cleared physical page frame (pre-zeroed by idle task if available)
+ * 
+ * @return Address of allocated frame (If not available, returns null)
+ */
+void* frame_allocZero(void) {
+    if (!memory_InitLock) { return NULL; }
+    memory_FramePool_t* p = &memory_Frames;
+    if (p->zeroc > 0) {
+        void* frame = (void*)((size_t)p->space + (p->zerov[--p->zeroc] * MEMORY_BLKSIZE));
+        memory_Stats.allocs++; MEMORY_PROFALLOC(frame, MEMORY_BLKSIZE);
+        return frame;
+    }
+    void* frame = frame_alloc(); if (frame != NULL) { fill(frame, 0, MEMORY_BLKSIZE); }
+    return frame;
+}
+
+/**
+ * @brief Function for clear free frames ahead of time (called by idle task)
+ * 
+ * @param count Frame limit to clear
+ * 
+ * @return Cleared frame count
+ */
+size_t frame_prezero(size_t count) {
+    if (!memory_InitLock) { return 0; }
+    memory_FramePool_t* p = &memory_Frames;
+    size_t done = 0;
+    // Keep a quarter of pool free for ordinary allocations
+    while (done < count && p->zeroc < MEMORY_ZEROSTACK && memory_Stats.framefree > p->framec / 4) {
+        size_t num = memory_frameTake(); if (num == MEMORY_NOBLOCK) { break; }
+        fill((void*)((size_t)p->space + (num * MEMORY_BLKSIZE)), 0, MEMORY_BLKSIZE);
+        p->zerov[p->zeroc++] = (uint32_t)num; ++done;
+    } return done;
+}
+
+/**
+ * @brief Function for allocate a page frame from high memory (not identity mapped, contents are not cleared)
+ * 
+ * @return Physical address of allocated frame (0 if not available)
+ */
+uint64_t frame_allocHigh(void) {
+    if (!memory_InitLock || memory_Stats.highfree == 0) { return 0; }
+    for (size_t i = 0; i < memory_HighC; ++i) {
+        memory_HighRegion_t* h = &memory_HighV[i];
+        for (size_t w = 0; w < h->words; ++w) {
+            size_t word = h->hint + w; if (word >= h->words) { word -= h->words; }
+            if (h->bitmap[word] == 0) { continue; }
+            size_t num = (word * 32) + __builtin_ctz(h->bitmap[word]);
+            h->bitmap[word] &= ~(1U << (num & 31)); h->hint = word;
+            memory_Stats.highfree--; memory_Stats.allocs++;
+            return h->base + ((uint64_t)num * MEMORY_BLKSIZE);
+        }
+    } return 0;
+}
+
+/**
+ * @brief Function for free a page frame of high memory
+ * 
+ * @param phys Physical address of frame
+ */
+void frame_freeHigh(uint64_t phys) {
+    if (!memory_InitLock) { return; }
+    for (size_t i = 0; i < memory_HighC; ++i) {
+        memory_HighRegion_t* h = &memory_HighV[i];
+        if (phys < h->base || phys >= h->base + ((uint64_t)h->framec * MEMORY_BLKSIZE)) { continue; }
+        size_t num = (size_t)((phys - h->base) / MEMORY_BLKSIZE);
+        if (h->bitmap[num >> 5] & (1U << (num & 31))) { return; }     // invalid free
+        h->bitmap[num >> 5] |= 1U << (num & 31);
+        memory_Stats.highfree++; memory_Stats.frees++;
+        return;
+    }
+}
+
+/**
+ * @brief Function for free a physical page frame
+ * 
+ * @param frame Address of frame
+ */
+void frame_free(void* frame) { frame_freeRun(frame, 1); }
+
+/**
+ * @brief Function for allocate a run of physically contiguous page frames
+ * 
+ * @param count Frame count of run
+ * 
+ * @return Address of first frame (If not available, returns null)
+ */
+void* frame_allocRun(size_t count) {
+    if (!memory_InitLock || count == 0) { return NULL; }
+    if (count == 1) { return frame_alloc(); }
+    size_t num = memory_frameTakeRun(count);
+    void* frame = (num != MEMORY_NOBLOCK) ?
+        (void*)((size_t)memory_Frames.space + (num * MEMORY_BLKSIZE)) : memory_alloc(count * MEMORY_BLKSIZE);
+    if (frame == NULL) { return NULL; }
+    if (num != MEMORY_NOBLOCK) { memory_Stats.allocs++; }
+    MEMORY_PROFALLOC(frame, count * MEMORY_BLKSIZE);
+    return frame;
+}
+
+/**
+ * @brief Function for free a run of page frames allocated by frame_alloc or frame_allocRun
+ * 
+ * @param frame Address of first frame
+ * @param count Frame count of run (same as allocation)
+ */
+void frame_freeRun(void* frame, size_t count) {
+    memory_FramePool_t* p = &memory_Frames;
+    if (!memory_InitLock || frame == NULL || count == 0) { return; }
+    if ((size_t)frame < (size_t)p->space || (size_t)frame >= (size_t)p->limit)
+        { MEMORY_PROFFREE(frame); memory_free(frame); return; }  // Run came from buddy allocator
+    size_t num = ((size_t)frame - (size_t)p->space) / MEMORY_BLKSIZE;
+    if (num + count > p->framec || !memory_frameUsed(num, count)) { return; }     // invalid free
+    if (count == 1 && p->refv[num] > 0) { --p->refv[num]; return; }               // Still shared
+    MEMORY_PROFFREE(frame);
+    memory_Stats.frees++;
+    memory_frameMark(num, count, true);
+    if (count == 1 && p->top < MEMORY_FRAMESTACK) { p->stack[p->top++] = (uint32_t)num; }
+}
+
+/**
+ * @brief Function for add a reference to a page frame (shared frames are freed by last frame_free)
+ * 
+ * @param frame Address of frame
+ * 
+ * @return Shared or not (true/false, frames from outside the pool can't be shared)
+ */
+bool frame_share(void* frame) {
+    memory_FramePool_t* p = &memory_Frames;
+    if (!memory_InitLock || (size_t)frame < (size_t)p->space || (size_t)frame >= (size_t)p->limit) { return false; }
+    size_t num = ((size_t)frame - (size_t)p->space) / MEMORY_BLKSIZE;
+    if (p->refv[num] == 0xFFFF || !memory_frameUsed(num, 1)) { return false; }
+    ++p->refv[num]; return true;
+}
+
+/**
+ * @brief Function for get extra reference count of a page frame
+ * 
+ * @param frame Address of frame
+ * 
+ * @return Reference count besides owner (0 means not shared)
+ */
+size_t frame_refs(void* frame) {
+    memory_FramePool_t* p = &memory_Frames;
+    if (!memory_InitLock || (size_t)frame < (size_t)p->space || (size_t)frame >= (size_t)p->limit) { return 0; }
+    return p->refv[((size_t)frame - (size_t)p->space) / MEMORY_BLKSIZE];
+}
 
-    size_t base = (size_t)&kernel_Limit + kernel_OSModuleSize;
+/**
+ * @brief Function for create an object cache
+ * 
+ * @param name Name of cache
+ * @param size Object size
+ * 
+ * @return Cache number (-1 means failure)
+ */
+int memory_cacheCreate(const char* name, size_t size) {
+    if (!memory_InitLock || name == NULL || size == 0 || size > MEMORY_BLKSIZE) { return -1; }
+    size = ALIGN(size, sizeof(void*));
+    for (int i = MEMORY_SLABCLASSES; i < MEMORY_CACHELIMIT; ++i) {
+        if (!memory_CacheV[i].active) { memory_cacheSetup(i, name, size); return i; }
+    } return -1;
+}
 
-    memory_Space = (void*)(base + (supblkc * sizeof(memory_Block_t)));
-    memory_Space = (void*)(((size_t)memory_Space + MEMORY_BLKSIZE) & ~((size_t)MEMORY_BLKSIZE - 1));
-    memory_Limit = (void*)((size_t)memory_Space + (supblkc * MEMORY_BLKSIZE));
+/**
+ * @brief Function for destroy an object cache (all objects must be freed)
+ * 
+ * @param cache Cache number
+ * 
+ * @return Operation status (-1 means failure)
+ */
+int memory_cacheDestroy(int cache) {
+    if (!memory_InitLock || cache < MEMORY_SLABCLASSES || cache >= MEMORY_CACHELIMIT ||
+        !memory_CacheV[cache].active) { return -1; }
+    memory_Cache_t* c = &memory_CacheV[cache];
+    if (c->pages > 1 || (c->pages == 1 &&
+        (c->partial == MEMORY_NOBLOCK || memory_frame(c->partial)->count != 0))) { return -1; }
+    if (c->pages == 1) {
+        memory_Zone_t* z = memory_findZone(c->partial * MEMORY_BLKSIZE);
+        z->blockv[c->partial - z->blockf].state = MEMORY_STATE_NONE; memory_Stats.slabs--;
+        memory_releaseRun(z, c->partial - z->blockf, 1);
+    }
+    c->active = false; c->pages = 0; c->partial = MEMORY_NOBLOCK; return 0;
+}
 
-    memory_BlockV = (memory_Block_t*)(base);
-    memory_BlockC = supblkc;
+/**
+ * @brief Function for allocate an object from an object cache
+ * 
+ * @param cache Cache number
+ * 
+ * @return Address of allocated object (If not available, returns null)
+ */
+void* memory_cacheAlloc(int cache) {
+    if (!memory_InitLock || cache < 0 || cache >= MEMORY_CACHELIMIT ||
+        !memory_CacheV[cache].active) { return NULL; }
+    void* obj = memory_slabAlloc(cache);
+    if (obj == NULL) { memory_Stats.failures++; } else { memory_Stats.allocs++; }
+    MEMORY_PROFALLOC(obj, memory_CacheV[cache].size);
+    return obj;
+}
+
+/**
+ * @brief Function for free an object back to its object cache
+ * 
+ * @param cache Cache number
+ * @param obj Address of object
+ */
+void memory_cacheFree(int cache, void* obj) {
+    if (!memory_InitLock || obj == NULL) { return; }
+    memory_Zone_t* z = memory_findZone((size_t)obj);
+    if (z == NULL) { return; }
+    size_t num = ((size_t)obj - (size_t)z->space) / MEMORY_BLKSIZE;
+    if (z->blockv[num].state != MEMORY_STATE_SLAB || z->blockv[num].cache != cache) { return; }
+    MEMORY_PROFFREE(obj);
+    memory_slabFree(z, num, obj);
+}
+
+/**
+ * @brief Function for set subsystem tag of following allocations (only for profiler builds)
+ * 
+ * @param tag Subsystem tag (null means tagging by return address)
+ */
+void memory_profTag(const char* tag) {
+#ifdef MEMORY_PROFILE
+    memory_ProfTag = tag;
+#else
+    (void)tag;
+#endif
+}
 
-    for (size_t i = 0; i < memory_BlockC; i++) {
-        memory_BlockV[i].count = 0;
-        memory_BlockV[i].allocated = false;
+/**
+ * @brief Function for dump top consumers and outstanding allocations over serial (only for profiler builds)
+ */
+void memory_report(void) {
+#ifdef MEMORY_PROFILE
+    bool serial = console_HardSerial; console_HardSerial = true;
+    printf("---- Memory profile ----\n");
+    // Sort call sites by live bytes
+    uint16_t order[MEMORY_PROFSITES]; size_t n = 0;
+    for (size_t i = 0; i < MEMORY_PROFSITES; ++i) {
+        if (memory_ProfSiteV[i].site == NULL) { continue; }
+        size_t j = n++; while (j > 0 && memory_ProfSiteV[order[j - 1]].bytes < memory_ProfSiteV[i].bytes)
+            { order[j] = order[j - 1]; --j; } order[j] = (uint16_t)i;
+    }
+    printf("Bytes\tLive\tAllocs\tSite\n");
+    for (size_t i = 0; i < n && i < MEMORY_PROFREPORT; ++i) {
+        memory_ProfSite_t* site = &memory_ProfSiteV[order[i]];
+        if (site->tag) { printf("%d\t%d\t%d\t%s\n", site->bytes, site->count, site->allocs, (const char*)site->site); }
+        else { printf("%d\t%d\t%d\t0x%x\n", site->bytes, site->count, site->allocs, (size_t)site->site); }
     }
-}
\ No newline at end of file
+    // List outstanding allocations
+    printf("Outstanding allocations:\n"); size_t live = 0;
+    for (size_t i = 0; i < MEMORY_PROFRECORDS; ++i) {
+        memory_ProfRec_t* rec = &memory_ProfRecV[i]; if (rec->blk == NULL) { continue; }
+        if (live++ >= MEMORY_PROFREPORT) { continue; }
+        memory_ProfSite_t* site = &memory_ProfSiteV[rec->site];
+        if (site->tag) { printf("0x%x\t%d\t%s\n", (size_t)rec->blk, rec->size, (const char*)site->site); }
+        else { printf("0x%x\t%d\t0x%x\n", (size_t)rec->blk, rec->size, (size_t)site->site); }
+    }
+    if (live > MEMORY_PROFREPORT) { printf("... and %d more\n", live - MEMORY_PROFREPORT); }
+    if (memory_ProfLost) { printf("Untracked allocations: %d\n", memory_ProfLost); }
+    console_HardSerial = serial;
+#else
+    WARN("Allocation profiler not enabled (build with PROFILE=1)");
+#endif
+}
@@ -1,18 +1,27 @@
 #include "kernel.h"
 
+#include "hw/paging.h"
+
 // * Imports
 
 // Imported context switch function from multitask_swi.s
 extern void multitask_swi(void* old, void* next);
 
+// Imported context save function from multitask_swi.s (returns 1 when saved context is switched to)
+extern int multitask_save(void* ctx) __attribute__((returns_twice));
+
 // * Constants
 
 #define MULTITASK_PROCLIMIT     32              // Process limit
 #define MULTITASK_NAMELIMIT     16              // Length limit for process name
-#define MULTITASK_STACKSIZE     (4 * 1024)      // Stack size for processes
+#define MULTITASK_STACKSIZE     (PAGING_USERLIMIT - PAGING_USERSTACK)   // Stack size for processes (pages mapped on first touch)
 
 #define MULTITASK_PROGMAGIC     0x464C457F      // Magic number of program files ("\x7FELF")
 #define MULTITASK_PROGPTLOAD    1
+#define MULTITASK_PROGPFWRITE   2               // Writable segment flag
+
+#define MULTITASK_FPUSIZE       512             // Size of FPU/SSE state area (FXSAVE format, FNSAVE uses first 108 bytes)
+#define MULTITASK_MXCSRDEF      0x1F80          // Default MXCSR value (all SIMD exceptions masked)
 
 // * Types and structures
 
@@ -28,8 +37,9 @@ typedef struct {
 typedef struct {
     char name[MULTITASK_NAMELIMIT];     // Name of process
     multitask_Ctx_t context;            // Context structure
-    void* stack;                        // Stack memory base pointer
+    void* stack;                        // Stack memory base pointer (demand-zero area of own address space)
     int parent; int user;               // Parent process and owner user
+    void* fpu;                          // FPU/SSE state area (allocated on first FPU use)
     bool file; bool freeze; bool active;    // Status
 } multitask_Proc_t;
 
@@ -77,37 +87,53 @@ multitask_Proc_t multitask_KernelProc;
 // Currently active process ID (0 at startup)
 int multitask_Focus = 0;
 
-// Process vector
-multitask_Proc_t* multitask_ProcV;
+// Process vector (null for free slots)
+multitask_Proc_t* multitask_ProcV[MULTITASK_PROCLIMIT];
+
+// Object cache of process structures
+int multitask_ProcCache = -1;
 
 // Default register values for new processes (Filled after initialization)
 multitask_Ctx_t multitask_DefRegs;
 
+// Address spaces of processes killed while running, by process ID (destroyed with process structure on a later switch)
+size_t multitask_ReapV[MULTITASK_PROCLIMIT];
+
+// Object cache of FPU/SSE state areas (objects are page aligned slabs, so 16-byte alignment of FXSAVE holds)
+int multitask_FPUCache = -1;
+
+// Process whose state is in FPU registers (-1 if none)
+int multitask_FPUOwner = -1;
+
+// Initial FPU/SSE state for processes (saved after initializing)
+uint8_t multitask_FPUInit[MULTITASK_FPUSIZE] __attribute__((aligned(16)));
+
 // * Subfunctions
 
 // A sentry for oversee target process
 void sentry(int pid) {
-    if (!multitask_InitLock || pid < 1 || pid >= MULTITASK_PROCLIMIT || !multitask_ProcV[pid].active) { return; }
-    multitask_Proc_t proc; ncopy(&proc, &multitask_ProcV[pid], sizeof(multitask_Proc_t));
+    if (!multitask_InitLock || pid < 1 || pid >= MULTITASK_PROCLIMIT ||
+        multitask_ProcV[pid] == NULL || !multitask_ProcV[pid]->active) { return; }
+    multitask_Proc_t proc; ncopy(&proc, multitask_ProcV[pid], sizeof(multitask_Proc_t));
     bool execution = true; char* reason;
-    if (multitask_ProcV[pid].context.ESP <= (size_t)multitask_ProcV[pid].stack) {
+    if (multitask_ProcV[pid]->context.ESP <= (size_t)multitask_ProcV[pid]->stack) {
         reason = "stack explosion";
-    } else if (multitask_ProcV[pid].context.ESP > ((size_t)multitask_ProcV[pid].stack + MULTITASK_STACKSIZE)) {
+    } else if (multitask_ProcV[pid]->context.ESP > ((size_t)multitask_ProcV[pid]->stack + MULTITASK_STACKSIZE)) {
         reason = "stack implosion";
     } else { execution = false; } if (execution) {
         if (kill(pid) != -1) {
             INFO("Process %d (%s) killed - %s", pid, proc.name, reason);
         } else {
-            multitask_ProcV[pid].freeze = true;
+            multitask_ProcV[pid]->freeze = true;
             INFO("Undying process %d (%s) freezed - %s", pid, proc.name, reason);
         }
     }
-    // if (multitask_ProcV[pid].context.ESP <= (size_t)multitask_ProcV[pid].stack) {
+    // if (multitask_ProcV[pid]->context.ESP <= (size_t)multitask_ProcV[pid]->stack) {
     //     if (kill(pid) != -1) { INFO("Process %d (%s) killed - stack explosion (%d bytes damaged)",
     //         pid, proc.name, (size_t)proc.stack - proc.context.ESP); }
     //     else {
-    //         if (!multitask_ProcV[pid].freeze) {
-    //             multitask_ProcV[pid].freeze = true;
+    //         if (!multitask_ProcV[pid]->freeze) {
+    //             multitask_ProcV[pid]->freeze = true;
     //             INFO("Undying process %d (%s) freezed - stack explosion (%d bytes damaged)",
     //                 pid, proc.name, (size_t)proc.stack - proc.context.ESP);
     //         }
@@ -115,6 +141,70 @@ void sentry(int pid) {
     // }
 }
 
+// Function for get a process structure (0 is kernel process)
+static inline multitask_Proc_t* multitask_proc(int pid) {
+    return pid ? multitask_ProcV[pid] : &multitask_KernelProc;
+}
+
+// Function for save FPU/SSE registers to a state area (FNSAVE also reinitializes FPU)
+static inline void multitask_fpuSave(void* area) {
+    if (KERNEL_HAS(KERNEL_FEAT_FXSR)) { asm volatile("fxsave (%0)"::"r"(area):"memory"); }
+    else { asm volatile("fnsave (%0)"::"r"(area):"memory"); }
+}
+
+// Function for load FPU/SSE registers from a state area
+static inline void multitask_fpuLoad(const void* area) {
+    if (KERNEL_HAS(KERNEL_FEAT_FXSR)) { asm volatile("fxrstor (%0)"::"r"(area):"memory"); }
+    else { asm volatile("frstor (%0)"::"r"(area):"memory"); }
+}
+
+// Function for set or clear task switched flag (next FPU/SSE instruction traps to #NM while it is set)
+static inline void multitask_setTS(bool set) {
+    size_t cr0; asm volatile("movl %%cr0, %0":"=r"(cr0));
+    size_t next = set ? (cr0 | 0x08) : (cr0 & ~0x08);
+    if (next != cr0) { asm volatile("movl %0, %%cr0"::"r"(next)); }
+}
+
+// Function for destroy address spaces and structures of killed processes (except current one)
+static void multitask_reap(void) {
+    size_t current = paging_current();
+    for (int i = 0; i < MULTITASK_PROCLIMIT; ++i) {
+        if (multitask_ReapV[i] == 0 || multitask_ReapV[i] == current) { continue; }
+        paging_destroySpace(multitask_ReapV[i]); multitask_ReapV[i] = 0;
+        memory_cacheFree(multitask_ProcCache, multitask_ProcV[i]); multitask_ProcV[i] = NULL;
+    }
+}
+
+// Function for create a process on an address space (destroyed on failure)
+static int multitask_create(const char* name, func_t prog, size_t space) {
+    int pid = 0; for (int i = 1; i < MULTITASK_PROCLIMIT; ++i) {
+        // Slot of a process killed while running is free again once it is reaped
+        if (multitask_ProcV[i] == NULL) { pid = i; break; }
+    } if (pid != 0) { multitask_ProcV[pid] = (multitask_Proc_t*)memory_cacheAlloc(multitask_ProcCache); }
+    if (pid == 0 || multitask_ProcV[pid] == NULL) { shm_detach(space); iocall_detach(space); paging_destroySpace(space); return -1; }
+    fill(multitask_ProcV[pid], 0, sizeof(multitask_Proc_t));
+    multitask_ProcV[pid]->stack = (void*)PAGING_USERSTACK;
+    if (name != NULL) {
+        if (length(name) < MULTITASK_NAMELIMIT) {
+            copy(multitask_ProcV[pid]->name, name);
+        } else { ncopy(multitask_ProcV[pid]->name, name, MULTITASK_NAMELIMIT - 1); }
+    } else { copy(multitask_ProcV[pid]->name, "[Unknown]"); }
+    multitask_ProcV[pid]->parent = 0; multitask_ProcV[pid]->fpu = NULL;
+    multitask_ProcV[pid]->context.EAX = 0;
+    multitask_ProcV[pid]->context.EBX = 0;
+    multitask_ProcV[pid]->context.ECX = 0;
+    multitask_ProcV[pid]->context.EDX = 0;
+    multitask_ProcV[pid]->context.ESI = 0;
+    multitask_ProcV[pid]->context.EDI = 0;
+    multitask_ProcV[pid]->context.EFLAGS = multitask_DefRegs.EFLAGS;
+    multitask_ProcV[pid]->context.EIP = (size_t)prog;
+    multitask_ProcV[pid]->context.CR3 = space;
+    multitask_ProcV[pid]->context.ESP = (size_t)multitask_ProcV[pid]->stack + MULTITASK_STACKSIZE;
+    multitask_ProcV[pid]->freeze = false; multitask_ProcV[pid]->active = true;
+    multitask_ProcV[pid]->file = false;
+    return pid;
+}
+
 // * Functions
 
 /**
@@ -127,31 +217,8 @@ void sentry(int pid) {
  */
 int spawn(const char* name, func_t prog) {
     if (!multitask_InitLock || prog == NULL) { return -1; }
-    int pid = 0; for (int i = 1; i < MULTITASK_PROCLIMIT; ++i) {
-        if (!multitask_ProcV[i].active) { pid = i; break; }
-    } if (pid == 0) { return -1; }
-    multitask_ProcV[pid].stack = malloc(MULTITASK_STACKSIZE);
-    if (multitask_ProcV[pid].stack == NULL) { return -1; }
-    fill(multitask_ProcV[pid].name, 0, MULTITASK_NAMELIMIT);
-    if (name != NULL) {
-        if (length(name) < MULTITASK_NAMELIMIT) {
-            copy(multitask_ProcV[pid].name, name);
-        } else { ncopy(multitask_ProcV[pid].name, name, MULTITASK_NAMELIMIT - 1); }
-    } else { copy(multitask_ProcV[pid].name, "[Unknown]"); }
-    multitask_ProcV[pid].parent = 0;
-    multitask_ProcV[pid].context.EAX = 0;
-    multitask_ProcV[pid].context.EBX = 0;
-    multitask_ProcV[pid].context.ECX = 0;
-    multitask_ProcV[pid].context.EDX = 0;
-    multitask_ProcV[pid].context.ESI = 0;
-    multitask_ProcV[pid].context.EDI = 0;
-    multitask_ProcV[pid].context.EFLAGS = multitask_DefRegs.EFLAGS;
-    multitask_ProcV[pid].context.EIP = (size_t)prog;
-    multitask_ProcV[pid].context.CR3 = multitask_DefRegs.CR3;
-    multitask_ProcV[pid].context.ESP = (size_t)multitask_ProcV[pid].stack + MULTITASK_STACKSIZE;
-    multitask_ProcV[pid].freeze = false; multitask_ProcV[pid].active = true;
-    multitask_ProcV[pid].file = false;
-    return pid;
+    size_t space = paging_createSpace(); if (space == 0) { return -1; }
+    return multitask_create(name, prog, space);
 }
 
 /**
@@ -166,39 +233,67 @@ int exec(const char* path) {
     fs_Entry_t* stat = fs_stat(path); if (stat == NULL) { return -1; }
     void* data = fs_readFile(path); if (data == NULL) { return -1; }
     multitask_ProgELF32EH_t* eh = (multitask_ProgELF32EH_t*)data;
-    if (*(uint32_t*)data != MULTITASK_PROGMAGIC) { return -1; }
+    if (stat->size < sizeof(multitask_ProgELF32EH_t) || *(uint32_t*)data != MULTITASK_PROGMAGIC) { return -1; }
+    if (eh->e_phoff > stat->size || eh->e_phnum > (stat->size - eh->e_phoff) / sizeof(multitask_ProgELF32PH_t)) { return -1; }
     multitask_ProgELF32PH_t* phs = (multitask_ProgELF32PH_t*)(data + eh->e_phoff);
-    uint32_t min_vaddr = 0xffffffff;
-    uint32_t max_vaddr = 0;
+    // Programs are linked at their final addresses, which must be in process address space
     for (int i = 0; i < eh->e_phnum; i++) {
         multitask_ProgELF32PH_t *ph = &phs[i];
         if (ph->p_type != MULTITASK_PROGPTLOAD) continue;
-        uint32_t seg_start = ph->p_vaddr;
-        uint32_t seg_end   = ph->p_vaddr + ph->p_memsz;
-        if (seg_start < min_vaddr) min_vaddr = seg_start;
-        if (seg_end > max_vaddr)   max_vaddr = seg_end;
+        if (ph->p_vaddr < PAGING_USERBASE || ph->p_vaddr >= PAGING_MMAPBASE || ph->p_memsz > PAGING_MMAPBASE - ph->p_vaddr ||
+            ph->p_filesz > ph->p_memsz || ph->p_offset > stat->size || ph->p_filesz > stat->size - ph->p_offset) { return -1; }
     }
-    min_vaddr &= ~(MEMORY_BLKSIZE - 1);
-    max_vaddr = (max_vaddr + MEMORY_BLKSIZE - 1) & ~(MEMORY_BLKSIZE - 1);
-    void* base = malloc((size_t)(max_vaddr - min_vaddr)); if (base == NULL) { return -1; }
+    size_t space = paging_createSpace(); if (space == 0) { return -1; }
+    // Archive data stays in memory, so segments of mounted programs are paged in on first touch (zero-copy if aligned),
+    // others are loaded now without switching (caller's stack isn't mapped there)
+    bool lazy = (stat->ftype == FS_TYPE_MOUNTED);
     for (int i = 0; i < eh->e_phnum; ++i) {
         multitask_ProgELF32PH_t* ph = &phs[i];
-        if (ph->p_type != MULTITASK_PROGPTLOAD) { continue; }
-        void* src = data + ph->p_offset;
-        void* dst = (void*)((size_t)base + ph->p_vaddr - min_vaddr);
-        ncopy(dst, src, ph->p_filesz);
-        fill(dst + ph->p_filesz, 0, ph->p_memsz - ph->p_filesz);
-        // printf("Segment %d: vaddr=0x%x, filesz=%d, memsz=%d, dst=0x%x\n",
-        //     i, phs[i].p_vaddr, phs[i].p_filesz, phs[i].p_memsz,
-        //     (unsigned int)(base + phs[i].p_vaddr));
-    } void (*entry)() = (void (*)())((size_t)base + eh->e_entry);
-    // INFO("0x%x", (size_t)base);
-    int pid = spawn(path, entry); if (pid == -1) { free(base); return -1; }
-    multitask_ProcV[pid].file = true;
+        if (ph->p_type != MULTITASK_PROGPTLOAD || ph->p_memsz == 0) { continue; }
+        uint32_t flags = PAGING_FLAG_USER | ((ph->p_flags & MULTITASK_PROGPFWRITE) ? PAGING_FLAG_WRITE : 0);
+        size_t inpage = ph->p_vaddr & (PAGING_PAGESIZE - 1), base = ph->p_vaddr - inpage;
+        // Backing data of area starts inpage bytes before segment, which must still be in file
+        bool loaded = (lazy && ph->p_offset >= inpage) ?
+            paging_addArea(space, base, inpage + ph->p_memsz, flags | PAGING_FLAG_SHARED,
+                data + ph->p_offset - inpage, inpage + ph->p_filesz) :
+            // Remaining part of segment is already cleared
+            paging_mapRange(space, ph->p_vaddr, ph->p_memsz, flags) &&
+                paging_copyTo(space, ph->p_vaddr, data + ph->p_offset, ph->p_filesz);
+        if (!loaded) { paging_destroySpace(space); return -1; }
+    } void (*entry)() = (void (*)())(size_t)eh->e_entry;
+    int pid = multitask_create(path, entry, space); if (pid == -1) { return -1; }
+    multitask_ProcV[pid]->file = true;
     // INFO("0x%x", (size_t)entry);
     return pid;
 }
 
+/**
+ * @brief Function for clone current process (address space pages are shared and copied on first write)
+ * 
+ * @return Process ID of new process for parent, 0 for new process (-1 means failure)
+ */
+int fork() {
+    if (!multitask_InitLock || !multitask_InStream || multitask_Focus <= 0 ||
+        multitask_Focus >= MULTITASK_PROCLIMIT) { return -1; }
+    int parent = multitask_Focus;
+    multitask_Ctx_t context;
+    if (multitask_save(&context)) { return 0; }     // New process continues from here
+    size_t space = paging_cloneSpace(multitask_ProcV[parent]->context.CR3); if (space == 0) { return -1; }
+    if (!shm_clone(multitask_ProcV[parent]->context.CR3, space)) { paging_destroySpace(space); return -1; }
+    if (!iocall_clone(multitask_ProcV[parent]->context.CR3, space)) { shm_detach(space); paging_destroySpace(space); return -1; }
+    int pid = multitask_create(multitask_ProcV[parent]->name, NULL, space); if (pid == -1) { return -1; }
+    // New process gets a copy of FPU/SSE state (live registers are saved first if parent owns them)
+    if (multitask_ProcV[parent]->fpu != NULL) {
+        if (multitask_FPUOwner == parent) {
+            multitask_setTS(false); multitask_fpuSave(multitask_ProcV[parent]->fpu); multitask_fpuLoad(multitask_ProcV[parent]->fpu);
+        } multitask_ProcV[pid]->fpu = memory_cacheAlloc(multitask_FPUCache);
+        if (multitask_ProcV[pid]->fpu != NULL) { ncopy(multitask_ProcV[pid]->fpu, multitask_ProcV[parent]->fpu, MULTITASK_FPUSIZE); }
+    } context.CR3 = space;
+    ncopy(&multitask_ProcV[pid]->context, &context, sizeof(multitask_Ctx_t));
+    multitask_ProcV[pid]->parent = parent; multitask_ProcV[pid]->file = multitask_ProcV[parent]->file;
+    return pid;
+}
+
 /**
  * @brief Function for kill a process
  * 
@@ -207,12 +302,22 @@ int exec(const char* path) {
  * @return Operation status (-1 means failure)
  */
 int kill(int pid) {
-    if (!multitask_InitLock || !multitask_ProcV[pid].active ||
-        pid <= 0 || pid >= MULTITASK_PROCLIMIT) { return -1; }
-    free(multitask_ProcV[pid].stack);
-    fill(multitask_ProcV[pid].name, 0, MULTITASK_NAMELIMIT);
-    fill(&multitask_ProcV[pid].context, 0, sizeof(multitask_Ctx_t));
-    multitask_ProcV[pid].active = false; return 0;
+    if (!multitask_InitLock || pid <= 0 || pid >= MULTITASK_PROCLIMIT ||
+        multitask_ProcV[pid] == NULL || !multitask_ProcV[pid]->active) { return -1; }
+    // Address space of running process (its stack is in use) is destroyed after switching away, structure
+    // stays until then since its context is saved on switch
+    size_t space = multitask_ProcV[pid]->context.CR3;
+    shm_detach(space); iocall_detach(space);
+    if (space != paging_current()) { paging_destroySpace(space); }
+    else { multitask_ReapV[pid] = space; }
+    if (multitask_FPUOwner == pid) { multitask_FPUOwner = -1; }
+    if (multitask_ProcV[pid]->fpu != NULL) { memory_cacheFree(multitask_FPUCache, multitask_ProcV[pid]->fpu); multitask_ProcV[pid]->fpu = NULL; }
+    multitask_ProcV[pid]->stack = NULL;
+    fill(multitask_ProcV[pid]->name, 0, MULTITASK_NAMELIMIT);
+    fill(&multitask_ProcV[pid]->context, 0, sizeof(multitask_Ctx_t));
+    multitask_ProcV[pid]->active = false;
+    if (multitask_ReapV[pid] == 0) { memory_cacheFree(multitask_ProcCache, multitask_ProcV[pid]); multitask_ProcV[pid] = NULL; }
+    return 0;
 }
 
 /**
@@ -220,22 +325,42 @@ int kill(int pid) {
  */
 void yield() {
     if (!multitask_InitLock) { return; } multitask_InStream = true;
+    multitask_reap();
     if (multitask_Focus < 0 || multitask_Focus >= MULTITASK_PROCLIMIT) { multitask_Focus = 0; }
     sentry(multitask_Focus);
     int next = 0; if (multitask_Focus == 0) {
         for (int i = 1; i < MULTITASK_PROCLIMIT; ++i) {
-            if (multitask_ProcV[i].active && !multitask_ProcV[i].freeze) { next = i; break; }
+            if (multitask_ProcV[i] != NULL && multitask_ProcV[i]->active && !multitask_ProcV[i]->freeze) { next = i; break; }
         } if (next == 0) { PANIC("No processes to execute"); }
     } else {
         for (int i = multitask_Focus + 1; i < MULTITASK_PROCLIMIT; ++i) {
-            if (multitask_ProcV[i].active && !multitask_ProcV[i].freeze) { next = i; break; }
+            if (multitask_ProcV[i] != NULL && multitask_ProcV[i]->active && !multitask_ProcV[i]->freeze) { next = i; break; }
         }
     } int old = multitask_Focus; if (old == next) { return; } multitask_Focus = next;
-    void* oldctx = old ? &multitask_ProcV[old].context : &multitask_KernelProc.context;
-    void* nextctx = next ? &multitask_ProcV[next].context : &multitask_KernelProc.context;
+    void* oldctx = old ? &multitask_ProcV[old]->context : &multitask_KernelProc.context;
+    void* nextctx = next ? &multitask_ProcV[next]->context : &multitask_KernelProc.context;
+    multitask_setTS(next != multitask_FPUOwner);   // FPU/SSE state is switched on first use
     multitask_swi(oldctx, nextctx);
 }
 
+/**
+ * @brief Function for handle device not available exception (switches FPU/SSE state to current process)
+ */
+void multitask_fpuTrap() {
+    asm volatile("clts");
+    // Hardware task switches (page faults) set TS too, current owner only continues
+    int focus = multitask_Focus; if (!multitask_InitLock || focus == multitask_FPUOwner) { return; }
+    if (multitask_FPUOwner != -1) {
+        multitask_Proc_t* owner = multitask_proc(multitask_FPUOwner);
+        if (owner->fpu != NULL) { multitask_fpuSave(owner->fpu); }
+    } multitask_Proc_t* proc = multitask_proc(focus);
+    if (proc->fpu == NULL) {
+        proc->fpu = memory_cacheAlloc(multitask_FPUCache);
+        if (proc->fpu != NULL) { ncopy(proc->fpu, multitask_FPUInit, MULTITASK_FPUSIZE); }
+    } if (proc->fpu == NULL) { multitask_fpuLoad(multitask_FPUInit); multitask_FPUOwner = -1; return; }
+    multitask_fpuLoad(proc->fpu); multitask_FPUOwner = focus;
+}
+
 /**
  * @brief Function for end current process
  */
@@ -250,10 +375,43 @@ void exit() {
  */
 void multitask_init() {
     if (multitask_InitLock) { return; }
-    multitask_ProcV = (multitask_Proc_t*)malloc(MULTITASK_PROCLIMIT * sizeof(multitask_Proc_t));
-    if (multitask_ProcV == NULL) { PANIC("Out of memory"); }
-    fill(multitask_ProcV, 0, MULTITASK_PROCLIMIT * sizeof(multitask_Proc_t));
+    multitask_ProcCache = memory_cacheCreate("proc", sizeof(multitask_Proc_t));
+    if (multitask_ProcCache == -1) { PANIC("Can't create process cache"); }
     asm volatile("movl %%cr3, %%eax\t\n movl %%eax, %0":"=m"(multitask_DefRegs.CR3)::"%eax");
     asm volatile("pushfl\t\n movl (%%esp), %%eax\t\n movl %%eax, %0\t\n popfl":"=m"(multitask_DefRegs.EFLAGS)::"%eax");
+    // Every address space has its own stack at same address, mapped on first touch
+    if (!paging_addArea(0, PAGING_USERSTACK, MULTITASK_STACKSIZE, PAGING_FLAG_WRITE | PAGING_FLAG_USER, NULL, 0))
+        { PANIC("Can't reserve process stack area"); }
+    // Enable FPU (MP: WAIT honors TS, NE: native errors) and SSE (OSFXSR, OSXMMEXCPT), save clean state for processes
+    asm volatile("movl %%cr0, %%eax\t\n andl $~0x04, %%eax\t\n orl $0x22, %%eax\t\n movl %%eax, %%cr0":::"%eax");
+    size_t cr4 = (KERNEL_HAS(KERNEL_FEAT_FXSR) ? 0x200 : 0) | (KERNEL_HAS(KERNEL_FEAT_SSE) ? 0x400 : 0);
+    if (cr4) { asm volatile("movl %%cr4, %%eax\t\n orl %0, %%eax\t\n movl %%eax, %%cr4"::"r"(cr4):"%eax"); }
+    asm volatile("clts\t\n fninit");
+    if (KERNEL_HAS(KERNEL_FEAT_SSE)) { uint32_t mxcsr = MULTITASK_MXCSRDEF; asm volatile("ldmxcsr %0"::"m"(mxcsr)); }
+    multitask_fpuSave(multitask_FPUInit);
+    multitask_FPUCache = memory_cacheCreate("fpu", MULTITASK_FPUSIZE);
+    if (multitask_FPUCache == -1) { PANIC("Can't create FPU state cache"); }
+    multitask_setTS(true);
     multitask_InitLock = true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Function for write memory usage of processes as text (used by /dev/procinfo)
+ * 
+ * @param buf Buffer to write
+ * @param len Length of buffer
+ * 
+ * @return Length of written text
+ */
+size_t multitask_info(char* buf, size_t len) {
+    if (buf == NULL || len == 0) { return 0; }
+    size_t pos = (size_t)snprintf(buf, len, "PID\tMemory\tPeak\tName\n");
+    for (int i = 1; multitask_InitLock && i < MULTITASK_PROCLIMIT && pos + 1 < len; ++i) {
+        if (multitask_ProcV[i] == NULL || !multitask_ProcV[i]->active) { continue; }
+        // Everything a process owns (image, stack, heap and file mappings) is mapped in its address space
+        size_t peak, used = paging_usage(multitask_ProcV[i]->context.CR3, &peak) * PAGING_PAGESIZE;
+        peak *= PAGING_PAGESIZE;
+        pos += (size_t)snprintf(buf + pos, len - pos, "%d\t%d KB\t%d KB\t%s\n",
+            i, used / 1024, peak / 1024, multitask_ProcV[i]->name);
+    } return pos;
+}
@@ -1,71 +1,68 @@
-.section .bss
-tmp: .skip 4    # Reserve 4 bytes for restoring stack pointer (ESP)
-
 .section .text
 .global multitask_swi   # Set context switch as global function
+.global multitask_save  # Set context save as global function
+
+# Every process has its stack at same virtual address, so the old stack is only
+# touched before CR3 is switched and the next stack only after that.
+# Context layout (multitask_Ctx_t): EAX 0, EBX 4, ECX 8, EDX 12, ESI 16, EDI 20, ESP 24, EBP 28, EIP 32, EFLAGS 36, CR3 40
+
 multitask_swi:
-    pusha   # Push all registers into stack (low to high: EDI, ESI, EBP, ESP, EBX, EDX, ECX, EAX. So pushes EAX first.)
-    pushf   # Push flags (EFLAGS) register into stack
-    mov %cr3, %eax  # Get CR3 register
-    push %eax       # Push CR3 register
-    # now, we have stack like that (low to high):
-    # CR3, EFLAGS, EDI, ESI, EBP, ESP, EBX, EDX, ECX, EAX, return address, first parameter, second parameter
-    mov 44(%esp), %eax  # Get first parameter from stack and set to EAX (old/current context to save)
-    # Save some registers to first parameter (old/current context)
+    mov 4(%esp), %eax   # Get first parameter (old/current context to save)
+    # Save callee visible registers to old context
+    movl $0, 0(%eax)    # EAX (return value of multitask_swi, unused)
     mov %ebx, 4(%eax)   # EBX
     mov %ecx, 8(%eax)   # ECX
     mov %edx, 12(%eax)  # EDX
     mov %esi, 16(%eax)  # ESI
     mov %edi, 20(%eax)  # EDI
-    # Move unsaved registers to saved registers
-    mov 36(%esp), %ebx  # Load EAX into EBX
-    mov 40(%esp), %ecx  # Load EIP into ECX
-    mov 20(%esp), %edx  # Load ESP into EDX
-    add $4, %edx        # Remove the return value by increasing ESP to 4
-    mov 16(%esp), %esi  # Load EBP into ESI
-    mov 4(%esp), %edi   # Load EFLAGS into EDI
-    # Save unsaved registers to first parameter (old/current context)
-    mov %ebx, 0(%eax)   # Save EAX
-    mov %edx, 24(%eax)  # Save EIP
-    mov %esi, 28(%eax)  # Save ESP
-    mov %ecx, 32(%eax)  # Save EBP
-    mov %edi, 36(%eax)  # Save EFLAGS
-    pop %ebx            # Pop CR3 into EBX from stack
-    mov %ebx, 40(%eax)  # Save CR3 to first parameter (old/current context)
-    push %ebx           # Push CR3 contained EBX back into stack
+    mov %ebp, 28(%eax)  # EBP
+    lea 4(%esp), %ecx   # ESP after returning to caller
+    mov %ecx, 24(%eax)  # ESP
+    mov (%esp), %ecx    # Return address
+    mov %ecx, 32(%eax)  # EIP
+    pushf               # Get flags (EFLAGS) register
+    pop %ecx
+    mov %ecx, 36(%eax)  # EFLAGS
+    mov %cr3, %ecx      # Get CR3 register
+    mov %ecx, 40(%eax)  # CR3
     # Now, load the second parameter (new/next context)
-    mov 48(%esp), %eax  # Load second parameter into EAX
-    mov 24(%eax), %ebx  # Load ESP to EBX from second parameter
-    sub $4, %ebx        # Decrease ESP contained EBX to 4 for set return value
-    mov 32(%eax), %ecx  # Load EIP to ECX from second parameter
-    mov %ecx, 0(%ebx)   # Load EIP contained ECX into top of ESP contained EBX
-    mov %ebx, tmp       # Load ESP contained EBX into memorh
-    # Load some registers to current registers from second parameter (stage 1)
-    mov 40(%eax), %ebx  # Load CR3 into EBX
-    mov 36(%eax), %ecx  # Load EFLAGS into ECX
-    mov 0(%eax), %edx   # Load EAX into EDX
-    mov 4(%eax), %esi   # Load EBX into ESI
-    mov 8(%eax), %edi   # Load ECX into EDI
-    # Load current loaded registers into stack (stage 1)
-    mov %ebx, 0(%esp)   # Load CR3 contained EBX
-    mov %ecx, 4(%esp)   # Load EFLAGS contained ECX
-    mov %edx, 36(%esp)  # Load EAX contained EDX
-    mov %esi, 24(%esp)  # Load EBX contained ESI
-    mov %edi, 32(%esp)  # Load ECX contained EDI
-    # Load some registers to current registers from second parameter (stage 2)
-    mov 12(%eax), %ebx  # Load EDX into EBX
-    mov 16(%eax), %ecx  # Load ESI into ECX
-    mov 20(%eax), %edx  # Load EDI into EDX
-    mov 28(%eax), %esi  # Load EBP into ESI
-    # Load current loaded registers into stack (stage 2)
-    mov %ebx, 28(%esp)  # Load EDX contained EBX
-    mov %ecx, 12(%esp)  # Load ESI contained ECX
-    mov %edx, 8(%esp)   # Load EDI contained EDX
-    mov %esi, 16(%esp)  # Load EBP contained ESI
-    # Restore everything
-    pop %eax            # Load CR3 into EAX from stack
-    mov %eax, %cr3      # Restore CR3 back
-    popf                # Restore EFLAGS back
-    popa                # Restore all registers
-    mov tmp, %esp       # Restore ESP from memory
+    mov 8(%esp), %eax   # Load second parameter into EAX (last access to old stack)
+    mov 40(%eax), %ecx  # Load CR3 into ECX
+    mov %ecx, %cr3      # Switch address space (kernel mappings are global, so stay in TLB)
+    mov %ecx, protect_TaskTSS+28    # Kernel task returns here after page faults (CPU never saves CR3)
+    mov %ecx, protect_FaultTSS+28   # Page faults are resolved in this address space
+    mov 24(%eax), %esp  # Load ESP (next stack is reachable from now on)
+    push 32(%eax)       # Push EIP as return address
+    push 36(%eax)       # Restore EFLAGS
+    popf
+    mov 4(%eax), %ebx   # Restore EBX
+    mov 8(%eax), %ecx   # Restore ECX
+    mov 12(%eax), %edx  # Restore EDX
+    mov 16(%eax), %esi  # Restore ESI
+    mov 20(%eax), %edi  # Restore EDI
+    mov 28(%eax), %ebp  # Restore EBP
+    mov 0(%eax), %eax   # Restore EAX
     ret                 # Return to next process
+
+# Saves current context like setjmp. Returns 0, and returns 1 when the saved context is switched to.
+multitask_save:
+    mov 4(%esp), %eax   # Get first parameter (context to save)
+    movl $1, 0(%eax)    # EAX (return value when resumed)
+    mov %ebx, 4(%eax)   # EBX
+    mov %ecx, 8(%eax)   # ECX
+    mov %edx, 12(%eax)  # EDX
+    mov %esi, 16(%eax)  # ESI
+    mov %edi, 20(%eax)  # EDI
+    mov %ebp, 28(%eax)  # EBP
+    lea 4(%esp), %ecx   # ESP after returning to caller
+    mov %ecx, 24(%eax)  # ESP
+    mov (%esp), %ecx    # Return address
+    mov %ecx, 32(%eax)  # EIP
+    pushf               # Get flags (EFLAGS) register
+    pop %ecx
+    mov %ecx, 36(%eax)  # EFLAGS
+    mov %cr3, %ecx      # Get CR3 register
+    mov %ecx, 40(%eax)  # CR3
+    mov 8(%eax), %ecx   # Restore ECX
+    xor %eax, %eax      # Return 0
+    ret
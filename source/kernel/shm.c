@@ -0,0 +1,199 @@
+#include "kernel.h"
+
+#include "hw/paging.h"
+
+// * Types and structures
+
+// Structure of shared memory object
+typedef struct {
+    char name[SHM_NAMELIMIT];   // Name of object (empty if slot free)
+    void* data;                 // Backing memory (vmalloc pages, mapped into every attached address space)
+    size_t size;                // Size of object (page aligned)
+    size_t refs;                // Handle and mapping count (object is freed when last one goes away)
+} shm_Object_t;
+
+// Structure of shared memory reference (an open handle or a mapping)
+typedef struct {
+    size_t space;       // Address space of reference (0 if slot free)
+    size_t virt;        // Base of mapping (0 for an open handle of create/open)
+    int object;         // Object of reference
+} shm_Map_t;
+
+// * Variables and tables
+
+shm_Object_t shm_ObjectV[SHM_OBJECTLIMIT];  // Shared memory objects
+shm_Map_t shm_MapV[SHM_MAPLIMIT];           // Handles and mappings of shared memory objects
+
+// * Subfunctions
+
+// Function for check whether an object number is valid
+static inline bool shm_valid(int object) {
+    return object >= 0 && object < SHM_OBJECTLIMIT && shm_ObjectV[object].name[0] != '\0';
+}
+
+// Function for find an object by name (returns -1 if not found)
+static int shm_find(const char* name) {
+    for (int i = 0; i < SHM_OBJECTLIMIT; ++i) {
+        if (shm_ObjectV[i].name[0] != '\0' && compare(shm_ObjectV[i].name, name) == 0) { return i; }
+    } return -1;
+}
+
+// Function for record a reference of an object (returns false if no slot left)
+static bool shm_record(size_t space, size_t virt, int object) {
+    for (int i = 0; i < SHM_MAPLIMIT; ++i) {
+        if (shm_MapV[i].space != 0) { continue; }
+        shm_MapV[i].space = space; shm_MapV[i].virt = virt; shm_MapV[i].object = object;
+        ++shm_ObjectV[object].refs; return true;
+    } return false;
+}
+
+// Function for drop a reference of an object (last one frees object)
+static void shm_drop(int object) {
+    shm_Object_t* o = &shm_ObjectV[object];
+    if (o->refs > 0 && --o->refs > 0) { return; }
+    vfree(o->data); fill(o, 0, sizeof(shm_Object_t));
+}
+
+// * Functions
+
+/**
+ * @brief System call for create a named shared memory object (contents are cleared, caller holds a handle until shm_close)
+ * 
+ * @param name Name of object
+ * @param size Size of object
+ * 
+ * @return Object number (-1 means failure)
+ */
+int shm_create(const char* name, size_t size) {
+    if (name == NULL || name[0] == '\0' || length(name) >= SHM_NAMELIMIT || size == 0 || shm_find(name) != -1) { return -1; }
+    for (int i = 0; i < SHM_OBJECTLIMIT; ++i) {
+        shm_Object_t* o = &shm_ObjectV[i]; if (o->name[0] != '\0') { continue; }
+        o->size = ALIGN(size, PAGING_PAGESIZE);
+        o->data = vmalloc(o->size); if (o->data == NULL) { return -1; }
+        fill(o->data, 0, o->size);
+        copy(o->name, name); o->refs = 0;
+        if (!shm_record(paging_current(), 0, i)) { vfree(o->data); fill(o, 0, sizeof(shm_Object_t)); return -1; }
+        return i;
+    } return -1;
+}
+
+/**
+ * @brief System call for open an existing shared memory object by name (caller holds a handle until shm_close)
+ * 
+ * @param name Name of object
+ * 
+ * @return Object number (-1 means failure)
+ */
+int shm_open(const char* name) {
+    if (name == NULL || name[0] == '\0') { return -1; }
+    int object = shm_find(name); if (object == -1) { return -1; }
+    return shm_record(paging_current(), 0, object) ? object : -1;
+}
+
+/**
+ * @brief System call for close a handle of shm_create or shm_open (mappings stay valid)
+ * 
+ * @param object Object number
+ * 
+ * @return Operation status (-1 means failure)
+ */
+int shm_close(int object) {
+    if (!shm_valid(object)) { return -1; }
+    size_t space = paging_current();
+    for (int i = 0; i < SHM_MAPLIMIT; ++i) {
+        shm_Map_t* m = &shm_MapV[i];
+        if (m->space != space || m->virt != 0 || m->object != object) { continue; }
+        m->space = 0; shm_drop(object);
+        return 0;
+    } return -1;
+}
+
+/**
+ * @brief System call for map a shared memory object into address space of caller
+ * (every mapping refers to same page frames, writes are seen by all of them at once)
+ * 
+ * @param object Object number
+ * @param prot Protection flags (PROT_READ, PROT_WRITE)
+ * 
+ * @return Address of mapping (If not available, returns null)
+ */
+void* shm_map(int object, int prot) {
+    if (!shm_valid(object)) { return NULL; }
+    shm_Object_t* o = &shm_ObjectV[object];
+    size_t space = paging_current(), virt = paging_findRange(space, o->size); if (virt == 0) { return NULL; }
+    // Frames stay owned by object, address spaces never free them
+    uint32_t flags = PAGING_FLAG_USER | PAGING_FLAG_SHARED | ((prot & PROT_WRITE) ? PAGING_FLAG_WRITE : 0);
+    for (size_t i = 0; i < o->size; i += PAGING_PAGESIZE) {
+        if (!paging_mapPage(space, virt + i, paging_phys((size_t)o->data + i), flags))
+            { paging_unmapRange(space, virt, i); return NULL; }
+    }
+    if (!shm_record(space, virt, object)) { paging_unmapRange(space, virt, o->size); return NULL; }
+    return (void*)virt;
+}
+
+/**
+ * @brief System call for unmap a mapping of shm_map
+ * 
+ * @param addr Address of mapping
+ * 
+ * @return Operation status (-1 means failure)
+ */
+int shm_unmap(void* addr) {
+    if (addr == NULL) { return -1; }
+    size_t space = paging_current();
+    for (int i = 0; i < SHM_MAPLIMIT; ++i) {
+        shm_Map_t* m = &shm_MapV[i];
+        if (m->space != space || m->virt != (size_t)addr) { continue; }
+        paging_unmapRange(space, m->virt, shm_ObjectV[m->object].size);
+        int object = m->object; m->space = 0; shm_drop(object);
+        return 0;
+    } return -1;
+}
+
+/**
+ * @brief Function for release shared memory mappings in a range of caller (used by munmap, only whole mappings can go)
+ * 
+ * @param addr Base of range
+ * @param len Length of range
+ * 
+ * @return 1 if range was a mapping and it is unmapped, 0 if range has no mapping, -1 if range covers part of one
+ */
+int shm_release(void* addr, size_t len) {
+    size_t space = paging_current(), base = (size_t)addr & ~(PAGING_PAGESIZE - 1);
+    size_t end = ALIGN((size_t)addr + len, PAGING_PAGESIZE);
+    for (int i = 0; i < SHM_MAPLIMIT; ++i) {
+        shm_Map_t* m = &shm_MapV[i];
+        if (m->space != space || m->virt == 0) { continue; }
+        size_t size = shm_ObjectV[m->object].size;
+        if (m->virt >= end || m->virt + size <= base) { continue; }
+        if (base != m->virt || end != m->virt + size) { return -1; }
+        return (shm_unmap((void*)m->virt) == 0) ? 1 : -1;
+    } return 0;
+}
+
+/**
+ * @brief Function for drop every shared memory handle and mapping of an address space (used when a process ends)
+ * 
+ * @param space Address space
+ */
+void shm_detach(size_t space) {
+    for (int i = 0; i < SHM_MAPLIMIT; ++i) {
+        if (space == 0 || shm_MapV[i].space != space) { continue; }
+        shm_MapV[i].space = 0; shm_drop(shm_MapV[i].object);
+    }
+}
+
+/**
+ * @brief Function for record shared memory handles and mappings of a cloned address space (page entries are copied by clone)
+ * 
+ * @param space Source address space
+ * @param clone Cloned address space
+ * 
+ * @return Recorded or not (true/false)
+ */
+bool shm_clone(size_t space, size_t clone) {
+    for (int i = 0; i < SHM_MAPLIMIT; ++i) {
+        if (space == 0 || shm_MapV[i].space != space) { continue; }
+        if (!shm_record(clone, shm_MapV[i].virt, shm_MapV[i].object)) { shm_detach(clone); return false; }
+    } return true;
+}
@@ -79,6 +79,14 @@ void syscall_init() {
     syscall_Table[SYS_WRITE] = write;
     syscall_Table[SYS_OPEN] = open;
     syscall_Table[SYS_CLOSE] = close;
+    syscall_Table[SYS_FORK] = fork;
+    syscall_Table[SYS_MMAP] = mmap;
+    syscall_Table[SYS_MUNMAP] = munmap;
+    syscall_Table[SYS_SHMCREATE] = shm_create;
+    syscall_Table[SYS_SHMOPEN] = shm_open;
+    syscall_Table[SYS_SHMMAP] = shm_map;
+    syscall_Table[SYS_SHMUNMAP] = shm_unmap;
+    syscall_Table[SYS_SHMCLOSE] = shm_close;
 
     interrupts_setGate(SYSCALL_INTVECTOR, (size_t)syscall_handler);
     interrupts_setGate(SYS_YIELD, (size_t)syscall_yieldRouter);
@@ -1,10 +1,37 @@
 #include "kernel.h"
 
 #include "hw/port.h"
+#include "hw/paging.h"
+
+// Word types for word-at-a-time string functions (may alias any data, unaligned one for loads of second string)
+typedef uint32_t __attribute__((may_alias)) utils_Word_t;
+typedef uint32_t __attribute__((may_alias, aligned(1))) utils_UWord_t;
+
+// Check whether a word has a zero byte (SWAR)
+#define UTILS_HASZERO(w)    (((w) - 0x01010101U) & ~(w) & 0x80808080U)
+
+// Reversed polynomial of CRC32C (Castagnoli, same one as SSE4.2 crc32 instruction)
+#define UTILS_CRC32CPOLY    0x82F63B78
 
 // Random access buffer for subfunction results
 char utils_RABuffer[64];
 
+// Primitives set to best variants by utils_patch (string instructions work on every CPU until then)
+static void utils_copyString(uint8_t* dest, const uint8_t* src, size_t len);
+static void utils_fillString(uint8_t* ptr, uint32_t pattern, size_t len);
+void (*utils_Copy)(uint8_t* dest, const uint8_t* src, size_t len) = utils_copyString;
+void (*utils_Fill)(uint8_t* ptr, uint32_t pattern, size_t len) = utils_fillString;
+
+// CRC32C primitives (work on uninverted state, software variants until utils_patch runs)
+static uint32_t utils_crcSoft(uint32_t crc, const uint8_t* data, size_t len);
+static uint32_t utils_copyCRCSoft(uint8_t* dest, const uint8_t* src, size_t len, uint32_t crc);
+uint32_t (*utils_CRC)(uint32_t crc, const uint8_t* data, size_t len) = utils_crcSoft;
+uint32_t (*utils_CopyCRC)(uint8_t* dest, const uint8_t* src, size_t len, uint32_t crc) = utils_copyCRCSoft;
+
+// Slicing-by-4 tables of software CRC32C (built on first use)
+static uint32_t utils_CRCTable[4][256];
+static bool utils_CRCReady = false;
+
 // * Subfunctions
 
 /**
@@ -32,6 +59,50 @@ void utils_cpuid(
     );
 }
 
+/**
+ * @brief Function for decode CPU features by CPUID instruction
+ * 
+ * @return Feature bitmap (KERNEL_FEAT_*)
+ */
+uint32_t utils_cpuFeatures() {
+    uint32_t eax, ebx, ecx, edx, features = 0;
+    utils_cpuid(0, 0, &eax, &ebx, &ecx, &edx); uint32_t maxleaf = eax;
+    // Basic features (EAX=1)
+    utils_cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (edx & (1 << 3)) { features |= KERNEL_FEAT_PSE; }
+    if (edx & (1 << 4)) { features |= KERNEL_FEAT_TSC; }
+    if (edx & (1 << 6)) { features |= KERNEL_FEAT_PAE; }
+    if (edx & (1 << 13)) { features |= KERNEL_FEAT_PGE; }
+    if (edx & (1 << 16)) { features |= KERNEL_FEAT_PAT; }
+    if (edx & (1 << 24)) { features |= KERNEL_FEAT_FXSR; }
+    if (edx & (1 << 25)) { features |= KERNEL_FEAT_SSE; }
+    if (edx & (1 << 26)) { features |= KERNEL_FEAT_SSE2; }
+    if (ecx & (1 << 5)) { features |= KERNEL_FEAT_VTX; }
+    if (ecx & (1 << 20)) { features |= KERNEL_FEAT_SSE42; }
+    if (ecx & (1 << 23)) { features |= KERNEL_FEAT_POPCNT; }
+    if (ecx & (1 << 25)) { features |= KERNEL_FEAT_AES; }
+    if (ecx & (1 << 26)) { features |= KERNEL_FEAT_XSAVE; }
+    if (ecx & (1 << 28)) { features |= KERNEL_FEAT_AVX; }
+    if (ecx & (1 << 30)) { features |= KERNEL_FEAT_RDRAND; }
+    // Extended features (EAX=7, ECX=0)
+    if (maxleaf >= 7) {
+        utils_cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+        if (ebx & (1 << 5)) { features |= KERNEL_FEAT_AVX2; }
+        if (ebx & (1 << 9)) { features |= KERNEL_FEAT_ERMS; }
+        if (edx & (1 << 4)) { features |= KERNEL_FEAT_FSRM; }
+    }
+    // Extended leaves (long mode at EAX=0x80000001, invariant TSC at EAX=0x80000007)
+    utils_cpuid(0x80000000, 0, &eax, &ebx, &ecx, &edx); uint32_t maxext = eax;
+    if (maxext >= 0x80000001) {
+        utils_cpuid(0x80000001, 0, &eax, &ebx, &ecx, &edx);
+        if (edx & (1 << 29)) { features |= KERNEL_FEAT_X64; }
+    }
+    if (maxext >= 0x80000007) {
+        utils_cpuid(0x80000007, 0, &eax, &ebx, &ecx, &edx);
+        if (edx & (1 << 8)) { features |= KERNEL_FEAT_TSCINV; }
+    } return features;
+}
+
 /**
  * @brief Function for read TSC (Time Stamp Counter)
  * 
@@ -44,6 +115,28 @@ uint64_t utils_rdtsc() {
     return ((uint64_t)high << 32) | low;
 }
 
+/**
+ * @brief Function for read MSR (Model Specific Register)
+ * 
+ * @param msr Register number
+ * 
+ * @return 64-bit register value
+ */
+uint64_t utils_rdmsr(uint32_t msr) {
+    uint32_t low, high;
+    asm volatile ("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * @brief Function for write MSR (Model Specific Register)
+ * 
+ * @param msr Register number
+ * @param value 64-bit register value
+ */
+void utils_wrmsr(uint32_t msr, uint64_t value)
+    { asm volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32))); }
+
 /**
  * @brief Function for convert binary-coded decimal to decimal number
  */
@@ -196,6 +289,19 @@ uint32_t fnv1ahash(const uint8_t* data, size_t len) {
     } return hash;
 }
 
+/**
+ * @brief Function for calculate CRC32C (Castagnoli) checksum of the given data
+ * 
+ * @param data Address of data buffer
+ * @param len Length of data buffer
+ * @param crc Checksum of preceding data (0 for start)
+ * 
+ * @return 32-bit checksum
+ */
+uint32_t crc32c(const uint8_t* data, size_t len, uint32_t crc) {
+    return ~utils_CRC(~crc, data, len);
+}
+
 /**
  * @brief Function for get current RTC (Real-Time Clock) date
  * 
@@ -243,6 +349,165 @@ void sleep(uint32_t sec) {
     }
 }
 
+// Function for copy a block with string instructions (destination aligned to dwords first)
+static void utils_copyString(uint8_t* dest, const uint8_t* src, size_t len) {
+    if (len >= 16) {
+        size_t head = (0 - (size_t)dest) & 3, words = (len - head) >> 2; len = (len - head) & 3;
+        asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(head) : : "memory");
+        asm volatile("rep movsl" : "+D"(dest), "+S"(src), "+c"(words) : : "memory");
+    } asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(len) : : "memory");
+}
+
+// Function for copy a large block with non-temporal stores (keeps destination out of cache)
+static void utils_copyNT(uint8_t* dest, const uint8_t* src, size_t len) {
+    size_t head = (0 - (size_t)dest) & 3, blocks = (len - head) >> 4; len = (len - head) & 15;
+    asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(head) : : "memory");
+    asm volatile(
+        "1:\n\t"
+        "movl (%1), %%eax\n\t" "movl 4(%1), %%edx\n\t" "movnti %%eax, (%0)\n\t" "movnti %%edx, 4(%0)\n\t"
+        "movl 8(%1), %%eax\n\t" "movl 12(%1), %%edx\n\t" "movnti %%eax, 8(%0)\n\t" "movnti %%edx, 12(%0)\n\t"
+        "addl $16, %1\n\t" "addl $16, %0\n\t" "decl %2\n\t" "jnz 1b\n\t"
+        "sfence"
+        : "+r"(dest), "+r"(src), "+r"(blocks) : : "eax", "edx", "memory", "cc");
+    asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(len) : : "memory");
+}
+
+// Function for fill a block with string instructions (destination aligned to dwords first)
+static void utils_fillString(uint8_t* ptr, uint32_t pattern, size_t len) {
+    if (len >= 16) {
+        size_t head = (0 - (size_t)ptr) & 3, words = (len - head) >> 2; len = (len - head) & 3;
+        asm volatile("rep stosb" : "+D"(ptr), "+c"(head) : "a"(pattern) : "memory");
+        asm volatile("rep stosl" : "+D"(ptr), "+c"(words) : "a"(pattern) : "memory");
+    } asm volatile("rep stosb" : "+D"(ptr), "+c"(len) : "a"(pattern) : "memory");
+}
+
+// Function for fill a large block with non-temporal stores (keeps destination out of cache)
+static void utils_fillNT(uint8_t* ptr, uint32_t pattern, size_t len) {
+    size_t head = (0 - (size_t)ptr) & 3, blocks = (len - head) >> 4; len = (len - head) & 15;
+    asm volatile("rep stosb" : "+D"(ptr), "+c"(head) : "a"(pattern) : "memory");
+    asm volatile(
+        "1:\n\t"
+        "movnti %2, (%0)\n\t" "movnti %2, 4(%0)\n\t" "movnti %2, 8(%0)\n\t" "movnti %2, 12(%0)\n\t"
+        "addl $16, %0\n\t" "decl %1\n\t" "jnz 1b\n\t"
+        "sfence"
+        : "+r"(ptr), "+r"(blocks) : "r"(pattern) : "memory", "cc");
+    asm volatile("rep stosb" : "+D"(ptr), "+c"(len) : "a"(pattern) : "memory");
+}
+
+// Function for copy a block with rep movsb (enhanced fast strings)
+static void utils_copyErms(uint8_t* dest, const uint8_t* src, size_t len) {
+    asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(len) : : "memory");
+}
+
+// Function for fill a block with rep stosb (enhanced fast strings)
+static void utils_fillErms(uint8_t* ptr, uint32_t pattern, size_t len) {
+    asm volatile("rep stosb" : "+D"(ptr), "+c"(len) : "a"(pattern) : "memory");
+}
+
+// Functions for copy and fill with string instructions, large blocks with non-temporal stores
+static void utils_copyStringNT(uint8_t* dest, const uint8_t* src, size_t len)
+    { if (len >= UTILS_MEM_NTLIMIT) { utils_copyNT(dest, src, len); } else { utils_copyString(dest, src, len); } }
+static void utils_fillStringNT(uint8_t* ptr, uint32_t pattern, size_t len)
+    { if (len >= UTILS_MEM_NTLIMIT) { utils_fillNT(ptr, pattern, len); } else { utils_fillString(ptr, pattern, len); } }
+static void utils_copyErmsNT(uint8_t* dest, const uint8_t* src, size_t len)
+    { if (len >= UTILS_MEM_NTLIMIT) { utils_copyNT(dest, src, len); } else { utils_copyErms(dest, src, len); } }
+static void utils_fillErmsNT(uint8_t* ptr, uint32_t pattern, size_t len)
+    { if (len >= UTILS_MEM_NTLIMIT) { utils_fillNT(ptr, pattern, len); } else { utils_fillErms(ptr, pattern, len); } }
+
+// Function for build slicing-by-4 tables of software CRC32C
+static void utils_crcTable(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i; for (int j = 0; j < 8; ++j) { crc = (crc >> 1) ^ (UTILS_CRC32CPOLY & (0 - (crc & 1))); }
+        utils_CRCTable[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int k = 1; k < 4; ++k)
+            { utils_CRCTable[k][i] = (utils_CRCTable[k - 1][i] >> 8) ^ utils_CRCTable[0][utils_CRCTable[k - 1][i] & 0xFF]; }
+    } utils_CRCReady = true;
+}
+
+// Function for add a little endian word to software CRC32C state
+static inline uint32_t utils_crcWord(uint32_t crc, uint32_t w) {
+    crc ^= w;
+    return utils_CRCTable[3][crc & 0xFF] ^ utils_CRCTable[2][(crc >> 8) & 0xFF] ^
+        utils_CRCTable[1][(crc >> 16) & 0xFF] ^ utils_CRCTable[0][crc >> 24];
+}
+
+// Function for calculate CRC32C with slicing-by-4 tables (a word per step)
+static uint32_t utils_crcSoft(uint32_t crc, const uint8_t* data, size_t len) {
+    if (!utils_CRCReady) { utils_crcTable(); }
+    for (; len >= 4; len -= 4, data += 4) { crc = utils_crcWord(crc, *(const utils_UWord_t*)data); }
+    for (; len > 0; --len) { crc = (crc >> 8) ^ utils_CRCTable[0][(crc ^ *data++) & 0xFF]; }
+    return crc;
+}
+
+// Function for copy a block and calculate CRC32C of it with slicing-by-4 tables
+static uint32_t utils_copyCRCSoft(uint8_t* dest, const uint8_t* src, size_t len, uint32_t crc) {
+    if (!utils_CRCReady) { utils_crcTable(); }
+    for (; len >= 4; len -= 4, src += 4, dest += 4) {
+        uint32_t w = *(const utils_UWord_t*)src; *(utils_UWord_t*)dest = w; crc = utils_crcWord(crc, w);
+    }
+    for (; len > 0; --len) { *dest = *src; crc = (crc >> 8) ^ utils_CRCTable[0][(crc ^ *src++) & 0xFF]; ++dest; }
+    return crc;
+}
+
+// Function for calculate CRC32C with SSE4.2 crc32 instruction (source aligned to dwords first)
+static uint32_t utils_crcHard(uint32_t crc, const uint8_t* data, size_t len) {
+    for (; len > 0 && ((size_t)data & 3); --len) { asm("crc32b %1, %0" : "+r"(crc) : "qm"(*data++)); }
+    for (; len >= 4; len -= 4, data += 4) { asm("crc32l %1, %0" : "+r"(crc) : "rm"(*(const utils_Word_t*)data)); }
+    for (; len > 0; --len) { asm("crc32b %1, %0" : "+r"(crc) : "qm"(*data++)); }
+    return crc;
+}
+
+// Function for copy a block and calculate CRC32C of it with SSE4.2 crc32 instruction (one pass)
+static uint32_t utils_copyCRCHard(uint8_t* dest, const uint8_t* src, size_t len, uint32_t crc) {
+    for (; len > 0 && ((size_t)src & 3); --len) { uint8_t b = *src++; *dest++ = b; asm("crc32b %1, %0" : "+r"(crc) : "qm"(b)); }
+    for (; len >= 4; len -= 4, src += 4, dest += 4) {
+        uint32_t w = *(const utils_Word_t*)src; *(utils_UWord_t*)dest = w; asm("crc32l %1, %0" : "+r"(crc) : "r"(w));
+    }
+    for (; len > 0; --len) { uint8_t b = *src++; *dest++ = b; asm("crc32b %1, %0" : "+r"(crc) : "qm"(b)); }
+    return crc;
+}
+
+// Structure of alternative (a variant of a primitive and CPU features it needs)
+typedef struct {
+    void** slot;            // Function pointer of primitive
+    void* variant;          // Variant function
+    uint32_t features;      // Required CPU features (KERNEL_FEAT_*)
+} utils_Alt_t;
+
+// Alternatives of primitives (grouped by primitive, best variant first, last one of group needs nothing),
+// non-temporal variants lose to plain ones on hosts with large caches, so they are taken only on opt-in
+static const utils_Alt_t utils_AltV[] = {
+    { (void**)&utils_Copy, utils_copyErmsNT, KERNEL_FEAT_ERMS | KERNEL_FEAT_SSE2 | KERNEL_FEAT_NTMEM },
+    { (void**)&utils_Copy, utils_copyStringNT, KERNEL_FEAT_SSE2 | KERNEL_FEAT_NTMEM },
+    { (void**)&utils_Copy, utils_copyErms, KERNEL_FEAT_ERMS },
+    { (void**)&utils_Copy, utils_copyErms, KERNEL_FEAT_FSRM },
+    { (void**)&utils_Copy, utils_copyString, 0 },
+    { (void**)&utils_Fill, utils_fillErmsNT, KERNEL_FEAT_ERMS | KERNEL_FEAT_SSE2 | KERNEL_FEAT_NTMEM },
+    { (void**)&utils_Fill, utils_fillStringNT, KERNEL_FEAT_SSE2 | KERNEL_FEAT_NTMEM },
+    { (void**)&utils_Fill, utils_fillErms, KERNEL_FEAT_ERMS },
+    { (void**)&utils_Fill, utils_fillString, 0 },
+    { (void**)&utils_CRC, utils_crcHard, KERNEL_FEAT_SSE42 },
+    { (void**)&utils_CRC, utils_crcSoft, 0 },
+    { (void**)&utils_CopyCRC, utils_copyCRCHard, KERNEL_FEAT_SSE42 },
+    { (void**)&utils_CopyCRC, utils_copyCRCSoft, 0 },
+};
+
+/**
+ * @brief Function for select best variants of primitives once at boot (callers then run them without feature checks)
+ * 
+ * @param features Available CPU features (KERNEL_FEAT_*, a subset forces older variants)
+ */
+void utils_patch(uint32_t features) {
+    void** done = NULL;
+    for (size_t i = 0; i < sizeof(utils_AltV) / sizeof(utils_AltV[0]); ++i) {
+        const utils_Alt_t* alt = &utils_AltV[i];
+        if (alt->slot == done || (alt->features & features) != alt->features) { continue; }
+        *alt->slot = alt->variant; done = alt->slot;
+    }
+}
+
 /**
  * @brief Function for fill a block of memory with specific value
  * 
@@ -254,9 +519,7 @@ void sleep(uint32_t sec) {
  */
 void* fill(void* ptr, char chr, size_t len) {
     uint8_t* point = ptr;
-    for (size_t i = 0; i < len; i++) {
-        point[i] = (uint8_t)chr;
-    }
+    utils_Fill(point, (uint8_t)chr * 0x01010101U, len);
     return ptr;
 }
 
@@ -291,12 +554,23 @@ char* copy(char* dest, const char* src) {
 void* ncopy(void* dest, const void* src, size_t len) {
     uint8_t* destination = dest;
     const uint8_t* source = src;
-    for (size_t i = 0; i < len; i++) {
-        destination[i] = source[i];
-    }
+    utils_Copy(destination, source, len);
     return dest;
 }
 
+/**
+ * @brief Function for copy a block of memory and calculate its CRC32C in same pass
+ * 
+ * @param dest Target destination
+ * @param src Source to copy
+ * @param len Length to be copied
+ * 
+ * @return CRC32C of copied data (same as crc32c(src, len, 0))
+ */
+uint32_t ncopysum(void* dest, const void* src, size_t len) {
+    return ~utils_CopyCRC(dest, src, len, ~0U);
+}
+
 /**
  * @brief Function for compare two strings
  * 
@@ -306,6 +580,16 @@ void* ncopy(void* dest, const void* src, size_t len) {
  * @return Returns 0 if there is no difference between strings
  */
 int compare(const char* str1, const char* str2) {
+    // Byte steps until first string is aligned
+    while (((size_t)str1 & 3) && *str1 && (*str1 == *str2)) { str1++; str2++; }
+    if (((size_t)str1 & 3) == 0) {
+        // Aligned words of first string never cross a page, second one is loaded only if its word stays in page
+        while (((size_t)str2 & (PAGING_PAGESIZE - 1)) <= PAGING_PAGESIZE - 4) {
+            uint32_t w = *(const utils_Word_t*)str1;
+            if (w != *(const utils_UWord_t*)str2 || UTILS_HASZERO(w)) { break; }
+            str1 += 4; str2 += 4;
+        }
+    }
     while (*str1 && (*str1 == *str2)) {
 		str1++;
 		str2++;
@@ -324,7 +608,10 @@ int compare(const char* str1, const char* str2) {
 int ncompare(const void* ptr1, const void* ptr2, size_t len) {
     unsigned char* p1 = (unsigned char*)ptr1;
     unsigned char* p2 = (unsigned char*)ptr2;
-    for (size_t i = 0; i < len; i++) {
+    // Skip equal words (loads stay inside both buffers), mismatching word is resolved byte by byte
+    size_t i = 0;
+    for (; i + 4 <= len && *(const utils_UWord_t*)(p1 + i) == *(const utils_UWord_t*)(p2 + i); i += 4);
+    for (; i < len; i++) {
         if (p1[i] != p2[i]) {
             return p1[i] - p2[i];
         }
@@ -340,11 +627,12 @@ int ncompare(const void* ptr1, const void* ptr2, size_t len) {
  * @return Length of specific string
  */
 int length(const char* str) {
-    int len = 0;
-    for (int i = 0; str[i] != '\0'; ++i) {
-        len++;
-    }
-    return len;
+    const char* end = str;
+    // Byte steps until aligned, then aligned words (never cross a page, over-read stays in mapped memory)
+    for (; (size_t)end & 3; ++end) { if (*end == '\0') { return (int)(end - str); } }
+    while (!UTILS_HASZERO(*(const utils_Word_t*)end)) { end += 4; }
+    while (*end != '\0') { ++end; }
+    return (int)(end - str);
 }
 
 /**
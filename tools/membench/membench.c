@@ -0,0 +1,404 @@
+#include "shim.h"
+
+// Host benchmark and stress harness of memory manager.
+// Runs randomized workloads and replays trace files given as arguments.
+// Trace file format is one operation per line ('#' starts a comment):
+//     a <slot> <size>     allocate into slot
+//     r <slot> <size>     reallocate slot
+//     f <slot>            free slot
+
+// * Constants
+
+#define MEMBENCH_SLOTS      16384               // Slot count of live allocations
+#define MEMBENCH_OPS        1000000             // Operation count of randomized workloads
+#define MEMBENCH_SAMPLE     65536               // Operation interval for fragmentation sampling
+#define MEMBENCH_TRACESIZE  (16 * 1024 * 1024)  // Size limit of trace files
+#define MEMBENCH_KEPTPAGES  8                   // Empty slab pages memory manager keeps (one per size class)
+
+#define MEMBENCH_SMALL      0                   // Randomized small objects (slab sizes)
+#define MEMBENCH_MIXED      1                   // Randomized log-uniform sizes up to 512KB
+#define MEMBENCH_APPEND     2                   // Growing buffers by realloc (file append pattern)
+
+#define MEMBENCH_COPYMAX    (16 * 1024 * 1024)  // Largest block of copy and fill benchmark
+#define MEMBENCH_COPYBYTES  (256 * 1024 * 1024) // Bytes moved by each copy and fill measurement
+
+// * Types and structures
+
+// Structure of live allocation slot
+typedef struct {
+    uint8_t* blk;       // Address of allocation (null if slot empty)
+    size_t size;        // Requested size
+} membench_Slot_t;
+
+// Structure of workload result
+typedef struct {
+    uint32_t ops;       // Timed operation count
+    uint64_t cycles;    // Total cycles of timed operations
+    uint32_t worst;     // Worst external fragmentation percent of samples
+    uint32_t frag;      // External fragmentation percent at end
+    uint32_t overhead;  // Internal overhead percent at end
+} membench_Result_t;
+
+// * Variables and tables
+
+membench_Slot_t membench_SlotV[MEMBENCH_SLOTS];     // Live allocation slots
+uint32_t        membench_LatV[MEMBENCH_OPS];        // Cycle latency of each timed operation
+uint32_t        membench_LatC;                      // Timed operation count
+uint32_t        membench_Seed = 0x12345678;         // Random generator state
+uint32_t        membench_MHz;                       // Calibrated TSC frequency
+uint32_t        membench_Fails;                     // Failed allocation count
+uint32_t        membench_Corrupt;                   // Corrupted allocation count
+size_t          membench_Live;                      // Requested bytes of live allocations
+size_t          membench_Base;                      // Used blocks before workload
+size_t          membench_Largest;                   // Largest free chunk of empty memory manager
+char            membench_Trace[MEMBENCH_TRACESIZE]; // Trace file buffer
+
+// * Subfunctions
+
+// Function for divide 64-bit number by 32-bit number (no libgcc in freestanding host build)
+static uint64_t membench_div(uint64_t num, uint32_t div) {
+    uint64_t quo = 0, rem = 0;
+    for (int i = 63; i >= 0; --i) {
+        rem = (rem << 1) | ((num >> i) & 1);
+        if (rem >= div) { rem -= div; quo |= (uint64_t)1 << i; }
+    } return quo;
+}
+
+// Function for generate next random number (xorshift32)
+static uint32_t membench_rand(void) {
+    membench_Seed ^= membench_Seed << 13;
+    membench_Seed ^= membench_Seed >> 17;
+    membench_Seed ^= membench_Seed << 5;
+    return membench_Seed;
+}
+
+// Function for record latency of a timed operation
+static void membench_record(uint64_t start) {
+    uint64_t cycles = utils_rdtsc() - start;
+    if (membench_LatC < MEMBENCH_OPS) { membench_LatV[membench_LatC++] = (cycles > UINT_MAX) ? UINT_MAX : (uint32_t)cycles; }
+}
+
+// Function for get tag byte of a slot
+static uint8_t membench_tag(size_t slot, size_t size) { return (uint8_t)((slot * 31) + size + 1); }
+
+// Function for check tag bytes of a slot (counts corruption)
+static void membench_check(size_t slot) {
+    membench_Slot_t* s = &membench_SlotV[slot];
+    uint8_t tag = membench_tag(slot, s->size);
+    if (s->blk[0] != tag || s->blk[s->size - 1] != tag) { membench_Corrupt++; }
+}
+
+// Function for write tag bytes of a slot
+static void membench_mark(size_t slot) {
+    membench_Slot_t* s = &membench_SlotV[slot];
+    s->blk[0] = s->blk[s->size - 1] = membench_tag(slot, s->size);
+}
+
+// Function for allocate into a slot
+static void membench_alloc(size_t slot, size_t size) {
+    if (membench_SlotV[slot].blk != NULL || size == 0) { return; }
+    uint64_t start = utils_rdtsc(); uint8_t* blk = (uint8_t*)malloc(size); membench_record(start);
+    if (blk == NULL) { membench_Fails++; return; }
+    membench_SlotV[slot].blk = blk; membench_SlotV[slot].size = size;
+    membench_Live += size; membench_mark(slot);
+}
+
+// Function for free a slot
+static void membench_free(size_t slot) {
+    if (membench_SlotV[slot].blk == NULL) { return; }
+    membench_check(slot);
+    uint64_t start = utils_rdtsc(); free(membench_SlotV[slot].blk); membench_record(start);
+    membench_Live -= membench_SlotV[slot].size;
+    membench_SlotV[slot].blk = NULL; membench_SlotV[slot].size = 0;
+}
+
+// Function for reallocate a slot (contents up to smaller size must be kept)
+static void membench_realloc(size_t slot, size_t size) {
+    membench_Slot_t* s = &membench_SlotV[slot];
+    if (s->blk == NULL) { membench_alloc(slot, size); return; }
+    if (size == 0) { return; }
+    membench_check(slot);
+    uint8_t first = s->blk[0];
+    uint64_t start = utils_rdtsc(); uint8_t* blk = (uint8_t*)realloc(s->blk, size); membench_record(start);
+    if (blk == NULL) { membench_Fails++; return; }
+    if (blk[0] != first) { membench_Corrupt++; }
+    membench_Live += size; membench_Live -= s->size;
+    s->blk = blk; s->size = size; membench_mark(slot);
+}
+
+// Function for get external fragmentation percent
+// (shortfall of largest free chunk against the largest chunk which free memory could form)
+static uint32_t membench_frag(void) {
+    memory_Stats_t st; memory_stats(&st);
+    size_t best = (st.free < membench_Largest) ? st.free : membench_Largest;
+    if (best == 0 || st.largestblock >= best) { return 0; }
+    return (uint32_t)(100 - (st.largestblock * 100) / best);
+}
+
+// Function for get internal overhead percent (used memory not requested by workload)
+static uint32_t membench_overhead(void) {
+    memory_Stats_t st; memory_stats(&st);
+    size_t used = st.used - membench_Base, live = (membench_Live + MEMORY_BLKSIZE - 1) / MEMORY_BLKSIZE;
+    if (used == 0 || live >= used) { return 0; }
+    return (uint32_t)(100 - (live * 100) / used);
+}
+
+// Function for select k-th smallest latency (partially reorders latencies)
+static uint32_t membench_select(uint32_t k) {
+    uint32_t lo = 0, hi = membench_LatC - 1;
+    while (lo < hi) {
+        uint32_t pivot = membench_LatV[lo + (hi - lo) / 2], i = lo, j = hi;
+        while (i <= j) {
+            while (membench_LatV[i] < pivot) { ++i; }
+            while (membench_LatV[j] > pivot) { --j; }
+            if (i <= j) {
+                uint32_t t = membench_LatV[i]; membench_LatV[i] = membench_LatV[j]; membench_LatV[j] = t;
+                ++i; if (j == 0) { break; } --j;
+            }
+        }
+        if (k <= j) { hi = j; } else if (k >= i) { lo = i; } else { break; }
+    } return membench_LatV[k];
+}
+
+// Function for convert cycles to nanoseconds
+static uint32_t membench_ns(uint32_t cycles) { return (uint32_t)membench_div((uint64_t)cycles * 1000, membench_MHz); }
+
+// Function for start a workload
+static void membench_begin(membench_Result_t* res) {
+    memory_Stats_t st; memory_stats(&st);
+    membench_Base = st.used; membench_Live = 0; membench_LatC = 0;
+    fill(res, 0, sizeof(membench_Result_t));
+}
+
+// Function for sample fragmentation during a workload
+static void membench_sample(membench_Result_t* res) {
+    uint32_t frag = membench_frag(); if (frag > res->worst) { res->worst = frag; }
+}
+
+// Function for finish a workload, free all slots and print result
+static void membench_end(const char* name, membench_Result_t* res) {
+    res->frag = membench_frag(); res->overhead = membench_overhead();
+    if (res->frag > res->worst) { res->worst = res->frag; }
+    res->ops = membench_LatC;
+    for (uint32_t i = 0; i < membench_LatC; ++i) { res->cycles += membench_LatV[i]; }
+    for (size_t i = 0; i < MEMBENCH_SLOTS; ++i) { membench_free(i); }
+    if (res->ops == 0) { printf("%s\tno operations\n", name); return; }
+    uint32_t avg = (uint32_t)membench_div(res->cycles, res->ops); if (avg == 0) { avg = 1; }
+    uint32_t opss = (uint32_t)membench_div((uint64_t)membench_MHz * 1000000, avg);
+    uint32_t p50 = membench_ns(membench_select(res->ops / 2));
+    uint32_t p99 = membench_ns(membench_select((uint32_t)membench_div((uint64_t)res->ops * 99, 100)));
+    uint32_t max = membench_ns(membench_select(res->ops - 1));
+    printf("%s\t%d\t%d\t%d\t%d\t%d\t%d%%/%d%%\t%d%%\n",
+        name, res->ops, opss, p50, p99, max, res->frag, res->worst, res->overhead);
+}
+
+// Function for run a randomized workload
+static void membench_random(const char* name, int kind, size_t slots) {
+    membench_Result_t res; membench_begin(&res);
+    for (uint32_t op = 0; op < MEMBENCH_OPS; ++op) {
+        uint32_t r = membench_rand(); size_t slot = (r >> 8) % slots;
+        if (op % MEMBENCH_SAMPLE == 0) { membench_sample(&res); }
+        if (kind == MEMBENCH_APPEND) {
+            // Buffers grow by small appends until 1MB, then start over
+            if (membench_SlotV[slot].blk == NULL) { membench_alloc(slot, 1 + (r & 0xFFF)); }
+            else if (membench_SlotV[slot].size > 1024 * 1024 || (r & 0xF) == 0) { membench_free(slot); }
+            else { membench_realloc(slot, membench_SlotV[slot].size + 1 + (membench_rand() & 0xFFF)); }
+            continue;
+        }
+        size_t size = (kind == MEMBENCH_SMALL) ? 16 + (membench_rand() % 497) :
+            (16U << (membench_rand() % 15)) + (membench_rand() & 0xFFFF) % (16U << (r % 15));
+        if (membench_SlotV[slot].blk == NULL) { membench_alloc(slot, size); }
+        else if ((r & 7) == 0) { membench_realloc(slot, size); }
+        else { membench_free(slot); }
+    } membench_end(name, &res);
+}
+
+// Function for copy bytes one at a time (reference for string variants)
+static void* membench_byteCopy(void* dst, const void* src, size_t len) {
+    uint8_t* d = dst; const uint8_t* s = src;
+    for (size_t i = 0; i < len; ++i) { d[i] = s[i]; }
+    return dst;
+}
+
+// Function for fill bytes one at a time (reference for string variants)
+static void* membench_byteFill(void* dst, char chr, size_t len) {
+    uint8_t* d = dst;
+    for (size_t i = 0; i < len; ++i) { d[i] = (uint8_t)chr; }
+    return dst;
+}
+
+// Function for measure throughput of a copy (or fill) routine in 0.1 GB/s units
+static uint32_t membench_rate(uint8_t* dst, const uint8_t* src, size_t size, void* (*copyFn)(void*, const void*, size_t),
+    void* (*setFn)(void*, char, size_t)) {
+    size_t rounds = MEMBENCH_COPYBYTES / size;
+    uint64_t start = utils_rdtsc();
+    for (size_t i = 0; i < rounds; ++i) { if (copyFn != NULL) { copyFn(dst, src, size); } else { setFn(dst, (char)i, size); } }
+    uint32_t us = (uint32_t)membench_div(utils_rdtsc() - start, membench_MHz); if (us == 0) { us = 1; }
+    return (uint32_t)membench_div((uint64_t)rounds * size, us * 100);
+}
+
+// Function for check copy and fill of a variant on unaligned, odd sized blocks (returns mismatch count)
+static uint32_t membench_verify(uint8_t* dst, uint8_t* src) {
+    uint32_t bad = 0;
+    for (size_t size = 0; size < 300; size += 7) {
+        for (size_t d = 0; d < 4; ++d) {
+            for (size_t i = 0; i < size; ++i) { src[i + 3] = (uint8_t)membench_rand(); }
+            dst[d + size] = 0xA5; ncopy(dst + d, src + 3, size);
+            if (ncompare(dst + d, src + 3, size) != 0 || dst[d + size] != 0xA5) { ++bad; }
+            fill(dst + d, 0x3C, size);
+            for (size_t i = 0; i < size; ++i) { if (dst[d + i] != 0x3C) { ++bad; break; } }
+            if (dst[d + size] != 0xA5) { ++bad; }
+        }
+    }
+    // Non-temporal path with unaligned head and tail
+    ncopy(dst + 1, src + 2, UTILS_MEM_NTLIMIT + 13);
+    if (ncompare(dst + 1, src + 2, UTILS_MEM_NTLIMIT + 13) != 0) { ++bad; }
+    fill(dst + 3, 0x77, UTILS_MEM_NTLIMIT + 5);
+    for (size_t i = 0; i < UTILS_MEM_NTLIMIT + 5; ++i) { if (dst[3 + i] != 0x77) { ++bad; break; } }
+    return bad;
+}
+
+// Function for run copy and fill benchmark of each variant supported by CPU (returns mismatch count)
+static uint32_t membench_copy(void) {
+    static const size_t sizes[] = { 4096, 65536, 1024 * 1024, MEMBENCH_COPYMAX };
+    static const char* names[] = { "bytes", "string", "erms", "string+nt", "erms+nt" };
+    // Variants are forced by patching primitives with a subset of CPU features, bytes is the local reference loop
+    static const uint32_t masks[] = { 0, 0, KERNEL_FEAT_ERMS, KERNEL_FEAT_SSE2 | KERNEL_FEAT_NTMEM,
+        KERNEL_FEAT_ERMS | KERNEL_FEAT_SSE2 | KERNEL_FEAT_NTMEM };
+    uint8_t* src = malloc(MEMBENCH_COPYMAX + 64); uint8_t* dst = malloc(MEMBENCH_COPYMAX + 64);
+    if (src == NULL || dst == NULL) { printf("copy\tunable to allocate buffers\n"); free(src); free(dst); return 1; }
+    fill(src, 0x5A, MEMBENCH_COPYMAX + 64);
+    // Non-temporal variants are an opt-in, measured here whenever CPU has SSE2
+    uint32_t selected = kernel_CPUInfo.features & KERNEL_FEAT_ERMS, bad = 0;
+    if (KERNEL_HAS(KERNEL_FEAT_SSE2 | KERNEL_FEAT_NTMEM)) { selected |= KERNEL_FEAT_SSE2 | KERNEL_FEAT_NTMEM; }
+    printf("Variant\tCopy GB/s (4K/64K/1M/16M)\tFill GB/s (4K/64K/1M/16M)\n");
+    for (size_t m = 0; m < sizeof(masks) / sizeof(masks[0]); ++m) {
+        if (!KERNEL_HAS(masks[m] & ~KERNEL_FEAT_NTMEM)) { continue; }
+        if (m != 0) { utils_patch(masks[m]); bad += membench_verify(dst, src); }
+        void* (*copyFn)(void*, const void*, size_t) = (m == 0) ? membench_byteCopy : ncopy;
+        void* (*setFn)(void*, char, size_t) = (m == 0) ? membench_byteFill : fill;
+        uint32_t copy[4], set[4];
+        for (size_t i = 0; i < 4; ++i)
+            { copy[i] = membench_rate(dst, src, sizes[i], copyFn, NULL); set[i] = membench_rate(dst, src, sizes[i], NULL, setFn); }
+        printf("%s%s\t%d.%d/%d.%d/%d.%d/%d.%d\t%d.%d/%d.%d/%d.%d/%d.%d\n", names[m], (m != 0 && masks[m] == selected) ? "*" : "",
+            copy[0] / 10, copy[0] % 10, copy[1] / 10, copy[1] % 10, copy[2] / 10, copy[2] % 10, copy[3] / 10, copy[3] % 10,
+            set[0] / 10, set[0] % 10, set[1] / 10, set[1] % 10, set[2] / 10, set[2] % 10, set[3] / 10, set[3] % 10);
+    }
+    utils_patch(kernel_CPUInfo.features); free(src); free(dst);
+    if (bad) { printf("Copy and fill mismatches: %d\n", bad); }
+    return bad;
+}
+
+// Function for measure throughput of crc32c (or ncopysum) in 0.1 GB/s units
+static uint32_t membench_crcRate(uint8_t* dst, const uint8_t* src, size_t size, bool copy) {
+    size_t rounds = MEMBENCH_COPYBYTES / size; uint32_t sum = 0;
+    uint64_t start = utils_rdtsc();
+    for (size_t i = 0; i < rounds; ++i) { sum ^= copy ? ncopysum(dst, src, size) : crc32c(src, size, sum); }
+    uint32_t us = (uint32_t)membench_div(utils_rdtsc() - start, membench_MHz); if (us == 0) { us = 1; }
+    if (sum == 0x12345678) { printf(" "); }    // Keep result alive
+    return (uint32_t)membench_div((uint64_t)rounds * size, us * 100);
+}
+
+// Function for run CRC32C check and benchmark of each backend supported by CPU (returns mismatch count)
+static uint32_t membench_crc(void) {
+    static const char* names[] = { "soft", "sse4.2" };
+    static const uint32_t masks[] = { 0, KERNEL_FEAT_SSE42 };
+    uint8_t* src = malloc(MEMBENCH_COPYMAX + 64); uint8_t* dst = malloc(MEMBENCH_COPYMAX + 64);
+    if (src == NULL || dst == NULL) { printf("crc\tunable to allocate buffers\n"); free(src); free(dst); return 1; }
+    for (size_t i = 0; i < MEMBENCH_COPYMAX + 64; ++i) { src[i] = (uint8_t)membench_rand(); }
+    uint32_t bad = 0, reference = 0; bool first = true;
+    printf("Backend\tCRC32C GB/s (64K/16M)\tCopy+CRC32C GB/s (64K/16M)\n");
+    for (size_t m = 0; m < sizeof(masks) / sizeof(masks[0]); ++m) {
+        if (!KERNEL_HAS(masks[m])) { continue; }
+        utils_patch(masks[m]);
+        // Check value of standard test vector, chaining and fused copy on unaligned, odd sized blocks
+        if (crc32c((const uint8_t*)"123456789", 9, 0) != 0xE3069283) { ++bad; }
+        for (size_t size = 0; size < 300; size += 7) {
+            for (size_t d = 0; d < 4; ++d) {
+                dst[d + size] = 0xA5; uint32_t sum = ncopysum(dst + d, src + 3, size);
+                if (sum != crc32c(src + 3, size, 0) || ncompare(dst + d, src + 3, size) != 0 || dst[d + size] != 0xA5) { ++bad; }
+                if (crc32c(src + 3 + size / 3, size - size / 3, crc32c(src + 3, size / 3, 0)) != sum) { ++bad; }
+            }
+        }
+        // Every backend gives same checksum
+        uint32_t whole = crc32c(src + 1, MEMBENCH_COPYMAX, 0);
+        if (first) { reference = whole; first = false; } else if (whole != reference) { ++bad; }
+        uint32_t sum[2], copy[2];
+        sum[0] = membench_crcRate(dst, src, 65536, false); sum[1] = membench_crcRate(dst, src, MEMBENCH_COPYMAX, false);
+        copy[0] = membench_crcRate(dst, src, 65536, true); copy[1] = membench_crcRate(dst, src, MEMBENCH_COPYMAX, true);
+        printf("%s%s\t%d.%d/%d.%d\t%d.%d/%d.%d\n", names[m], KERNEL_HAS(KERNEL_FEAT_SSE42) == (m == 1) ? "*" : "",
+            sum[0] / 10, sum[0] % 10, sum[1] / 10, sum[1] % 10, copy[0] / 10, copy[0] % 10, copy[1] / 10, copy[1] % 10);
+    }
+    utils_patch(kernel_CPUInfo.features); free(src); free(dst);
+    if (bad) { printf("CRC32C mismatches: %d\n", bad); }
+    return bad;
+}
+
+// Function for parse a decimal number from trace text
+static size_t membench_number(const char** str) {
+    while (**str == ' ' || **str == '\t') { ++*str; }
+    size_t num = 0; while (**str >= '0' && **str <= '9') { num = (num * 10) + (size_t)(**str - '0'); ++*str; }
+    return num;
+}
+
+// Function for replay a trace file
+static int membench_replay(const char* path) {
+    int len = shim_readFile(path, membench_Trace, MEMBENCH_TRACESIZE - 1);
+    if (len < 0) { printf("%s\tunable to read trace\n", path); return -1; }
+    membench_Trace[len] = '\0';
+    membench_Result_t res; membench_begin(&res); uint32_t op = 0;
+    for (const char* line = membench_Trace; *line != '\0';) {
+        const char* cur = line + 1; char cmd = *line;
+        if (cmd == 'a' || cmd == 'r' || cmd == 'f') {
+            size_t slot = membench_number(&cur) % MEMBENCH_SLOTS;
+            size_t size = (cmd != 'f') ? membench_number(&cur) : 0;
+            if (cmd == 'a') { membench_alloc(slot, size); }
+            else if (cmd == 'r') { membench_realloc(slot, size); }
+            else { membench_free(slot); }
+            if (++op % MEMBENCH_SAMPLE == 0) { membench_sample(&res); }
+        }
+        while (*line != '\0' && *line != '\n') { ++line; } if (*line == '\n') { ++line; }
+    } membench_end(path, &res); return 0;
+}
+
+// * Functions
+
+/**
+ * @brief Main function of host benchmark
+ *
+ * @param argc Argument count
+ * @param argv Arguments (trace files to replay)
+ *
+ * @return Exit code (non-zero if corruption, leak or unreadable trace found)
+ */
+int membench_main(int argc, char** argv) {
+    memory_init(SHIM_ARENASIZE);
+    size_t baseline = mavail();
+    memory_Stats_t st; memory_stats(&st); membench_Largest = st.largestblock;
+
+    // Calibrate TSC frequency against monotonic clock
+    uint32_t t0 = shim_time(); uint64_t c0 = utils_rdtsc();
+    while (shim_time() - t0 < 100000);
+    uint32_t t1 = shim_time(); uint64_t c1 = utils_rdtsc();
+    membench_MHz = (uint32_t)membench_div(c1 - c0, t1 - t0); if (membench_MHz == 0) { membench_MHz = 1; }
+
+    // Select variants of primitives same way as kernel does
+    kernel_CPUInfo.features = utils_cpuFeatures(); utils_patch(kernel_CPUInfo.features);
+
+    printf("Memory manager benchmark (%d MB arena, %d MHz TSC)\n", SHIM_ARENASIZE / (1024 * 1024), membench_MHz);
+    printf("Workload\tOps\tOps/s\tp50 ns\tp99 ns\tMax ns\tExtFrag(end/worst)\tOverhead\n");
+    int status = 0;
+    membench_random("small", MEMBENCH_SMALL, MEMBENCH_SLOTS);
+    membench_random("mixed", MEMBENCH_MIXED, 512);
+    membench_random("append", MEMBENCH_APPEND, 64);
+    for (int i = 1; i < argc; ++i) { if (membench_replay(argv[i]) == -1) { status = 1; } }
+    if (membench_copy() != 0) { status = 1; }
+    if (membench_crc() != 0) { status = 1; }
+
+    if (membench_Fails) { printf("Failed allocations: %d\n", membench_Fails); }
+    if (membench_Corrupt) { printf("Corrupted allocations: %d\n", membench_Corrupt); status = 1; }
+    // Only slab pages kept for size classes may stay in use after all slots freed
+    if (baseline - mavail() > MEMBENCH_KEPTPAGES * MEMORY_BLKSIZE)
+        { printf("Leaked memory: %d KB\n", (baseline - mavail()) / 1024); status = 1; }
+    return status;
+}
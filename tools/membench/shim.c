@@ -0,0 +1,112 @@
+#include "shim.h"
+
+// Host shim for running memory manager as a freestanding 32-bit Linux program.
+// Supplies kernel_Limit, kernel globals used by memory.c/utils.c and raw system calls.
+
+// * Constants
+
+#define SHIM_SYS_EXIT           1       // Linux i386 exit
+#define SHIM_SYS_READ           3       // Linux i386 read
+#define SHIM_SYS_WRITE          4       // Linux i386 write
+#define SHIM_SYS_OPEN           5       // Linux i386 open
+#define SHIM_SYS_CLOSE          6       // Linux i386 close
+#define SHIM_SYS_CLOCKGETTIME   265     // Linux i386 clock_gettime
+#define SHIM_CLOCK_MONOTONIC    1       // Monotonic clock ID
+
+// * Variables and tables
+
+// Static arena placed as kernel limit, so memory manager takes it as free memory
+char shim_Arena[SHIM_ARENASIZE] __attribute__((aligned(MEMORY_BLKSIZE)));
+__asm__(".globl kernel_Limit\n.set kernel_Limit, shim_Arena");
+
+size_t              kernel_PhysicalSize;
+size_t              kernel_OSModuleSize;
+uint64_t            kernel_MemorySize;
+kernel_CPUInfo_t    kernel_CPUInfo = { .has_tsc = 1 };     // TSC is used for latency measurement
+bool                multitask_InStream = false;
+bool                console_HardSerial = false;
+
+// * Subfunctions
+
+// Function for make a raw Linux system call
+static int shim_syscall(int num, int a, int b, int c) {
+    int ret;
+    asm volatile ("int $0x80" : "=a"(ret) : "a"(num), "b"(a), "c"(b), "d"(c) : "memory");
+    return ret;
+}
+
+// * Kernel replacements
+
+void yield(void) {}
+
+// No paging on host, calloc falls back to cleared blocks
+void* vzalloc(size_t size) { (void)size; return NULL; }
+void vfree(void* addr) { (void)addr; }
+size_t vsize(void* addr) { (void)addr; return 0; }
+
+void console_print(const char* str, int len) {
+    int n = 0; while (n < len && str[n] != '\0') { ++n; }
+    shim_syscall(SHIM_SYS_WRITE, 1, (int)str, n);
+}
+
+uint8_t port_inb(uint16_t port) { (void)port; return 0; }
+
+void port_outb(uint16_t port, uint8_t data) { (void)port; (void)data; }
+
+// * Functions
+
+/**
+ * @brief Function for exit host process
+ * 
+ * @param code Exit code
+ */
+void shim_exit(int code) {
+    shim_syscall(SHIM_SYS_EXIT, code, 0, 0);
+    while (true);
+}
+
+/**
+ * @brief Function for get monotonic time
+ * 
+ * @return Time in microseconds (wraps about every 71 minutes)
+ */
+uint32_t shim_time(void) {
+    struct { int32_t sec; int32_t nsec; } ts;
+    shim_syscall(SHIM_SYS_CLOCKGETTIME, SHIM_CLOCK_MONOTONIC, (int)&ts, 0);
+    return (uint32_t)ts.sec * 1000000U + (uint32_t)ts.nsec / 1000U;
+}
+
+/**
+ * @brief Function for read a host file
+ * 
+ * @param path Path of file
+ * @param buf Buffer to store content
+ * @param len Length of buffer
+ * 
+ * @return Number of bytes read (-1 means failure)
+ */
+int shim_readFile(const char* path, char* buf, size_t len) {
+    int fd = shim_syscall(SHIM_SYS_OPEN, (int)path, 0, 0); if (fd < 0) { return -1; }
+    size_t total = 0; while (total < len) {
+        int n = shim_syscall(SHIM_SYS_READ, fd, (int)(buf + total), (int)(len - total));
+        if (n < 0) { shim_syscall(SHIM_SYS_CLOSE, fd, 0, 0); return -1; }
+        if (n == 0) { break; } total += (size_t)n;
+    } shim_syscall(SHIM_SYS_CLOSE, fd, 0, 0);
+    return (int)total;
+}
+
+// Entry point of host process (passes argc and argv from initial stack)
+__asm__(
+    ".globl _start\n"
+    "_start:\n"
+    "   xorl %ebp, %ebp\n"
+    "   movl (%esp), %eax\n"
+    "   leal 4(%esp), %ecx\n"
+    "   andl $-16, %esp\n"
+    "   subl $8, %esp\n"
+    "   pushl %ecx\n"
+    "   pushl %eax\n"
+    "   call membench_main\n"
+    "   pushl %eax\n"
+    "   call shim_exit\n"
+);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "kernel.h"
+
+// * Constants
+
+#define SHIM_ARENASIZE      (256 * 1024 * 1024)     // Size of static arena given to memory manager
+
+// * Functions
+
+void        shim_exit(int code);                                // Exits host process
+uint32_t    shim_time(void);                                    // Gets monotonic time in microseconds
+int         shim_readFile(const char* path, char* buf, size_t len);     // Reads a host file (-1 means failure)